@@ -0,0 +1,812 @@
+#include "compressed_base.h"
+
+#include <zlib.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace compressed {
+
+    namespace {
+        const char MAGIC[8] = { 'T', 'C', 'Z', 'B', 'A', 'S', 'E', '\0' };
+        const uint32_t COMPRESSED_VERSION = 2;
+        // Координаты хранятся целыми в десятимиллионных долях градуса (около сантиметра);
+        // значения, которые так не восстанавливаются точно, пишутся отдельно как есть
+        const double COORDINATE_SCALE = 1e7;
+        // Порция, которой читается и распаковывается секция
+        const size_t CHUNK_SIZE = 64 * 1024;
+
+        // Секции идут в файле именно в этом порядке
+        enum class SectionId : uint32_t {
+            STRINGS,
+            STOPS,
+            DISTANCES,
+            BUSES,
+            STOP_INDEX,
+            BUS_INDEX,
+            NAME_PREFIXES,
+            RENDER_SETTINGS,
+            ROUTER,
+            // Необязательная: есть, только если при make_base просили сохранить карту
+            MAP
+        };
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+        };
+
+        struct SectionHeader {
+            uint32_t id;
+            uint32_t reserved;
+            uint64_t compressed_size;
+        };
+
+        [[noreturn]] void ThrowCorrupted() {
+            throw runtime_error("Corrupted compressed base"s);
+        }
+
+        uint64_t ZigZag(int64_t value) {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
+
+        int64_t UnZigZag(uint64_t value) {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        // Квантованное значение, если из него координата восстанавливается без потерь
+        optional<int64_t> Quantize(double value) {
+            const double scaled = value * COORDINATE_SCALE;
+            if (!(abs(scaled) < 1e15)) return nullopt;
+            const int64_t result = llround(scaled);
+            const double restored = static_cast<double>(result) / COORDINATE_SCALE;
+            if (restored != value || signbit(restored) != signbit(value)) return nullopt;
+            return result;
+        }
+
+        // Несжатое содержимое секции
+        class SectionBuilder {
+        public:
+            void WriteVarint(uint64_t value) {
+                while (value >= 0x80) {
+                    data_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                    value >>= 7;
+                }
+                data_.push_back(static_cast<char>(value));
+            }
+
+            void WriteSigned(int64_t value) {
+                WriteVarint(ZigZag(value));
+            }
+
+            void WriteDouble(double value) {
+                data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+
+            void WriteBytes(string_view bytes) {
+                WriteVarint(bytes.size());
+                data_.append(bytes);
+            }
+
+            const string& GetData() const {
+                return data_;
+            }
+
+        private:
+            string data_;
+        };
+
+        void WriteSection(ostream& output, SectionId id, const SectionBuilder& section) {
+            const string& data = section.GetData();
+            if (data.size() > numeric_limits<uInt>::max()) {
+                throw length_error("Section is too large for compression"s);
+            }
+            z_stream zs{};
+            if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK) {
+                throw runtime_error("Cannot initialize zlib"s);
+            }
+            string compressed(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            zs.avail_in = static_cast<uInt>(data.size());
+            zs.next_out = reinterpret_cast<Bytef*>(compressed.data());
+            zs.avail_out = static_cast<uInt>(compressed.size());
+            const int rc = deflate(&zs, Z_FINISH);
+            compressed.resize(zs.total_out);
+            deflateEnd(&zs);
+            if (rc != Z_STREAM_END) {
+                throw runtime_error("Cannot compress section"s);
+            }
+            const SectionHeader header{ static_cast<uint32_t>(id), 0, compressed.size() };
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            output.write(compressed.data(), compressed.size());
+        }
+
+        // Распаковывает одну секцию порциями по мере чтения значений
+        class SectionReader {
+        public:
+            SectionReader(istream& input, SectionId id)
+                : input_(input)
+                , in_(CHUNK_SIZE)
+                , out_(CHUNK_SIZE)
+            {
+                SectionHeader header;
+                if (!input_.read(reinterpret_cast<char*>(&header), sizeof(header))
+                    || header.id != static_cast<uint32_t>(id)) {
+                    ThrowCorrupted();
+                }
+                compressed_left_ = header.compressed_size;
+                if (inflateInit(&zs_) != Z_OK) {
+                    throw runtime_error("Cannot initialize zlib"s);
+                }
+            }
+
+            SectionReader(const SectionReader&) = delete;
+            SectionReader& operator=(const SectionReader&) = delete;
+
+            ~SectionReader() {
+                inflateEnd(&zs_);
+            }
+
+            uint64_t ReadVarint() {
+                uint64_t result = 0;
+                for (int shift = 0; shift < 64; shift += 7) {
+                    const auto byte = static_cast<unsigned char>(ReadByte());
+                    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80)) return result;
+                }
+                ThrowCorrupted();
+            }
+
+            // Количество элементов; ограничение защищает от огромных выделений на мусоре
+            size_t ReadCount() {
+                const uint64_t result = ReadVarint();
+                if (result > numeric_limits<uint32_t>::max()) {
+                    ThrowCorrupted();
+                }
+                return static_cast<size_t>(result);
+            }
+
+            int64_t ReadSigned() {
+                return UnZigZag(ReadVarint());
+            }
+
+            double ReadDouble() {
+                double result;
+                Read(reinterpret_cast<char*>(&result), sizeof(result));
+                return result;
+            }
+
+            string ReadBytes() {
+                string result(ReadCount(), '\0');
+                Read(result.data(), result.size());
+                return result;
+            }
+
+            void Read(char* dest, size_t size) {
+                while (size > 0) {
+                    if (pos_ == end_ && !Refill()) {
+                        ThrowCorrupted();
+                    }
+                    const size_t n = min(size, end_ - pos_);
+                    memcpy(dest, out_.data() + pos_, n);
+                    pos_ += n;
+                    dest += n;
+                    size -= n;
+                }
+            }
+
+            // Проверяет, что секция прочитана ровно до конца
+            void Finish() {
+                if (pos_ != end_ || Refill() || compressed_left_ != 0 || zs_.avail_in != 0) {
+                    ThrowCorrupted();
+                }
+            }
+
+        private:
+            istream& input_;
+            z_stream zs_{};
+            uint64_t compressed_left_ = 0;
+            bool finished_ = false;
+            vector<char> in_;
+            vector<char> out_;
+            size_t pos_ = 0;
+            size_t end_ = 0;
+
+            char ReadByte() {
+                if (pos_ == end_ && !Refill()) {
+                    ThrowCorrupted();
+                }
+                return out_[pos_++];
+            }
+
+            // Распаковывает следующую порцию; false, если секция закончилась
+            bool Refill() {
+                pos_ = end_ = 0;
+                while (!finished_ && end_ == 0) {
+                    if (zs_.avail_in == 0) {
+                        if (compressed_left_ == 0) {
+                            ThrowCorrupted();
+                        }
+                        const size_t n = static_cast<size_t>(min<uint64_t>(CHUNK_SIZE, compressed_left_));
+                        if (!input_.read(in_.data(), n)) {
+                            ThrowCorrupted();
+                        }
+                        compressed_left_ -= n;
+                        zs_.next_in = reinterpret_cast<Bytef*>(in_.data());
+                        zs_.avail_in = static_cast<uInt>(n);
+                    }
+                    zs_.next_out = reinterpret_cast<Bytef*>(out_.data());
+                    zs_.avail_out = static_cast<uInt>(out_.size());
+                    const int rc = inflate(&zs_, Z_NO_FLUSH);
+                    if (rc == Z_STREAM_END) {
+                        finished_ = true;
+                    }
+                    else if (rc != Z_OK) {
+                        ThrowCorrupted();
+                    }
+                    end_ = out_.size() - zs_.avail_out;
+                }
+                return end_ > 0;
+            }
+        };
+
+        // Строки: остановки, затем маршруты; номер строки совпадает с номером объекта
+        SectionBuilder EncodeStrings(const tc::Catalogue& tcat, NameIds& ids) {
+            SectionBuilder result;
+            result.WriteVarint(tcat.GetAllStops().size() + tcat.GetAllBuses().size());
+            string data;
+            // Номер — позиция в таблице: маршрут может называться так же, как остановка,
+            // и тогда ids.size() отстаёт от числа записанных строк
+            uint32_t position = 0;
+            const auto add = [&](string_view name) {
+                ids.emplace(name, position++);
+                result.WriteVarint(name.size());
+                data += name;
+            };
+            for (const auto& s : tcat.GetAllStops()) {
+                add(s->name);
+            }
+            for (const auto& b : tcat.GetAllBuses()) {
+                add(b->name);
+            }
+            result.WriteBytes(data);
+            return result;
+        }
+
+        // Сетка над остановками и координаты в порядке её ячеек: соседние точки близки,
+        // и разности квантованных координат укладываются в один-два байта
+        SectionBuilder EncodeStops(const tc::Catalogue& tcat) {
+            SectionBuilder result;
+            const auto& stops = tcat.GetAllStops();
+            result.WriteVarint(stops.size());
+
+            const tc::SpatialIndex& grid = tcat.GetStopGrid();
+            const tc::SpatialIndex::Layout& layout = grid.GetLayout();
+            result.WriteDouble(layout.min.lat);
+            result.WriteDouble(layout.min.lng);
+            result.WriteDouble(layout.max.lat);
+            result.WriteDouble(layout.max.lng);
+            result.WriteVarint(layout.rows);
+            result.WriteVarint(layout.cols);
+            const vector<uint32_t>& cell_start = grid.GetCellStart();
+            result.WriteVarint(cell_start.size());
+            for (size_t i = 1; i < cell_start.size(); ++i) {
+                result.WriteVarint(cell_start[i] - cell_start[i - 1]);
+            }
+            const vector<uint32_t>& order = grid.GetItems();
+            for (const uint32_t i : order) {
+                result.WriteVarint(i);
+            }
+
+            vector<uint32_t> exceptions;
+            const auto write_column = [&](double geo::Coordinates::* field) {
+                int64_t previous = 0;
+                for (const uint32_t i : order) {
+                    const optional<int64_t> value = Quantize(stops[i]->coordinates.*field);
+                    result.WriteSigned(value.value_or(previous) - previous);
+                    previous = value.value_or(previous);
+                }
+            };
+            write_column(&geo::Coordinates::lat);
+            write_column(&geo::Coordinates::lng);
+            for (uint32_t i = 0; i < stops.size(); ++i) {
+                if (!Quantize(stops[i]->coordinates.lat) || !Quantize(stops[i]->coordinates.lng)) {
+                    exceptions.push_back(i);
+                }
+            }
+            result.WriteVarint(exceptions.size());
+            for (const uint32_t i : exceptions) {
+                result.WriteVarint(i);
+                result.WriteDouble(stops[i]->coordinates.lat);
+                result.WriteDouble(stops[i]->coordinates.lng);
+            }
+            return result;
+        }
+
+        SectionBuilder EncodeDistances(const tc::Catalogue& tcat, const NameIds& ids) {
+            SectionBuilder result;
+            const auto& stops = tcat.GetAllStops();
+            for (const auto& s : stops) {
+                result.WriteVarint(s->stop_distances.size());
+            }
+            for (size_t i = 0; i < stops.size(); ++i) {
+                for (const auto& [n, d] : stops[i]->stop_distances) {
+                    result.WriteSigned(static_cast<int64_t>(ids.at(n)) - static_cast<int64_t>(i));
+                }
+            }
+            for (const auto& s : stops) {
+                for (const auto& [n, d] : s->stop_distances) {
+                    result.WriteSigned(d);
+                }
+            }
+            return result;
+        }
+
+        SectionBuilder EncodeBuses(const tc::Catalogue& tcat, const NameIds& ids) {
+            SectionBuilder result;
+            const auto& buses = tcat.GetAllBuses();
+            result.WriteVarint(buses.size());
+            for (const auto& b : buses) {
+                result.WriteVarint(b->stops.size());
+            }
+            for (const auto& b : buses) {
+                result.WriteVarint(b->is_circle ? 1 : 0);
+            }
+            for (const auto& b : buses) {
+                result.WriteVarint(b->final_stop ? ids.at(b->final_stop->name) + 1 : 0);
+            }
+            for (const auto& b : buses) {
+                int64_t previous = 0;
+                for (const auto& s : b->stops) {
+                    const int64_t id = ids.at(s->name);
+                    result.WriteSigned(id - previous);
+                    previous = id;
+                }
+            }
+            return result;
+        }
+
+        SectionBuilder EncodeNameIndex(const tc::NameIndex& index) {
+            SectionBuilder result;
+            result.WriteVarint(index.GetSalt());
+            result.WriteVarint(index.GetDisplacements().size());
+            for (const uint32_t d : index.GetDisplacements()) {
+                result.WriteVarint(d);
+            }
+            result.WriteVarint(index.GetSlots().size());
+            for (const uint32_t s : index.GetSlots()) {
+                result.WriteVarint(s);
+            }
+            result.WriteVarint(index.GetSortedOrder().size());
+            for (const uint32_t i : index.GetSortedOrder()) {
+                result.WriteVarint(i);
+            }
+            return result;
+        }
+
+        SectionBuilder EncodeNamePrefixes(const tc::PrefixIndex& prefixes) {
+            SectionBuilder result;
+            result.WriteVarint(prefixes.Size());
+            result.WriteBytes(prefixes.GetData());
+            const vector<uint32_t>& offsets = prefixes.GetBlockOffsets();
+            result.WriteVarint(offsets.size());
+            uint32_t previous = 0;
+            for (const uint32_t offset : offsets) {
+                result.WriteVarint(offset - previous);
+                previous = offset;
+            }
+            return result;
+        }
+
+        // Рёбра сгруппированы по исходной вершине, то есть по спискам смежности;
+        // конец ребра пишется разностью с началом, номер — разностью с предыдущим
+        SectionBuilder EncodeRouter(const tc::Router& router, const NameIds& ids) {
+            SectionBuilder result;
+            result.WriteBytes(GetRouterSettingSerialize(router.GetSettings()).SerializeAsString());
+
+            const graph::DirectedWeightedGraph<double>& g = router.GetGraph();
+            vector<graph::EdgeId> order;
+            order.reserve(g.GetEdgeCount());
+            result.WriteVarint(g.GetVertexCount());
+            result.WriteVarint(g.GetEdgeCount());
+            for (graph::VertexId v = 0; v < g.GetVertexCount(); ++v) {
+                const auto edges = g.GetIncidentEdges(v);
+                result.WriteVarint(edges.end() - edges.begin());
+                for (const graph::EdgeId id : edges) {
+                    if (g.GetEdge(id).from != v) {
+                        throw logic_error("Edge is listed outside its source vertex"s);
+                    }
+                    order.push_back(id);
+                }
+            }
+            if (order.size() != g.GetEdgeCount()) {
+                throw logic_error("Incidence lists do not cover graph edges"s);
+            }
+            int64_t previous = 0;
+            for (const graph::EdgeId id : order) {
+                result.WriteSigned(static_cast<int64_t>(id) - previous);
+                previous = static_cast<int64_t>(id);
+            }
+            for (const graph::EdgeId id : order) {
+                const graph::Edge<double>& edge = g.GetEdge(id);
+                result.WriteSigned(static_cast<int64_t>(edge.to) - static_cast<int64_t>(edge.from));
+            }
+            for (const graph::EdgeId id : order) {
+                result.WriteVarint(ids.at(g.GetEdge(id).name));
+            }
+            for (const graph::EdgeId id : order) {
+                result.WriteVarint(g.GetEdge(id).quality);
+            }
+            for (const graph::EdgeId id : order) {
+                result.WriteDouble(g.GetEdge(id).weight);
+            }
+
+            const tc::StopIds& stop_ids = router.GetStopIds();
+            result.WriteVarint(stop_ids.size());
+            for (const auto& [n, id] : stop_ids) {
+                result.WriteVarint(ids.at(n));
+            }
+            previous = 0;
+            for (const auto& [n, id] : stop_ids) {
+                result.WriteSigned(static_cast<int64_t>(id) - previous);
+                previous = static_cast<int64_t>(id);
+            }
+            return result;
+        }
+
+        // Строки складываются в один буфер, который каталог принимает без копирования
+        vector<string_view> DecodeStrings(istream& input, tc::Catalogue& tcat) {
+            SectionReader section(input, SectionId::STRINGS);
+            vector<size_t> lengths(section.ReadCount());
+            for (size_t& length : lengths) {
+                length = section.ReadCount();
+            }
+            auto data = make_shared<const string>(section.ReadBytes());
+            section.Finish();
+
+            vector<string_view> result;
+            result.reserve(lengths.size());
+            size_t offset = 0;
+            for (const size_t length : lengths) {
+                if (length > data->size() - offset) {
+                    ThrowCorrupted();
+                }
+                result.push_back(string_view(*data).substr(offset, length));
+                offset += length;
+            }
+            tcat.AdoptNames(data, *data);
+            return result;
+        }
+
+        void DecodeStops(istream& input, tc::Catalogue& tcat, const vector<string_view>& names) {
+            SectionReader section(input, SectionId::STOPS);
+            const size_t stop_count = section.ReadCount();
+            if (stop_count > names.size()) {
+                ThrowCorrupted();
+            }
+
+            tc::SpatialIndex::Layout layout;
+            layout.min.lat = section.ReadDouble();
+            layout.min.lng = section.ReadDouble();
+            layout.max.lat = section.ReadDouble();
+            layout.max.lng = section.ReadDouble();
+            layout.rows = static_cast<uint32_t>(section.ReadCount());
+            layout.cols = static_cast<uint32_t>(section.ReadCount());
+            vector<uint32_t> cell_start(section.ReadCount());
+            for (size_t i = 1; i < cell_start.size(); ++i) {
+                cell_start[i] = cell_start[i - 1] + static_cast<uint32_t>(section.ReadCount());
+            }
+            vector<uint32_t> order(stop_count);
+            vector<bool> seen(stop_count, false);
+            for (uint32_t& i : order) {
+                i = static_cast<uint32_t>(section.ReadCount());
+                if (i >= stop_count || seen[i]) {
+                    ThrowCorrupted();
+                }
+                seen[i] = true;
+            }
+
+            vector<geo::Coordinates> coordinates(stop_count);
+            const auto read_column = [&](double geo::Coordinates::* field) {
+                int64_t value = 0;
+                for (const uint32_t i : order) {
+                    value += section.ReadSigned();
+                    coordinates[i].*field = static_cast<double>(value) / COORDINATE_SCALE;
+                }
+            };
+            read_column(&geo::Coordinates::lat);
+            read_column(&geo::Coordinates::lng);
+            const size_t exception_count = section.ReadCount();
+            for (size_t k = 0; k < exception_count; ++k) {
+                const size_t i = section.ReadCount();
+                if (i >= stop_count) {
+                    ThrowCorrupted();
+                }
+                coordinates[i].lat = section.ReadDouble();
+                coordinates[i].lng = section.ReadDouble();
+            }
+            section.Finish();
+
+            for (size_t i = 0; i < stop_count; ++i) {
+                tcat.AddStop(names[i], coordinates[i]);
+            }
+            tcat.SetStopGrid(tc::SpatialIndex(layout, move(cell_start), move(order), coordinates));
+        }
+
+        void DecodeDistances(istream& input, tc::Catalogue& tcat) {
+            SectionReader section(input, SectionId::DISTANCES);
+            const auto& stops = tcat.GetAllStops();
+            vector<size_t> counts(stops.size());
+            for (size_t& count : counts) {
+                count = section.ReadCount();
+            }
+            vector<vector<tc::Stop*>> targets(stops.size());
+            for (size_t i = 0; i < stops.size(); ++i) {
+                targets[i].reserve(counts[i]);
+                for (size_t j = 0; j < counts[i]; ++j) {
+                    const int64_t to = static_cast<int64_t>(i) + section.ReadSigned();
+                    if (to < 0 || static_cast<size_t>(to) >= stops.size()) {
+                        ThrowCorrupted();
+                    }
+                    targets[i].push_back(stops[to].get());
+                }
+            }
+            for (size_t i = 0; i < stops.size(); ++i) {
+                for (tc::Stop* to : targets[i]) {
+                    tcat.SetDistance(stops[i].get(), to, static_cast<int>(section.ReadSigned()));
+                }
+            }
+            section.Finish();
+        }
+
+        void DecodeBuses(istream& input, tc::Catalogue& tcat, const vector<string_view>& names) {
+            SectionReader section(input, SectionId::BUSES);
+            const auto& stops = tcat.GetAllStops();
+            const size_t bus_count = section.ReadCount();
+            if (stops.size() + bus_count != names.size()) {
+                ThrowCorrupted();
+            }
+            vector<size_t> stop_counts(bus_count);
+            for (size_t& count : stop_counts) {
+                count = section.ReadCount();
+            }
+            vector<bool> is_circle(bus_count);
+            for (size_t i = 0; i < bus_count; ++i) {
+                is_circle[i] = section.ReadVarint() != 0;
+            }
+            vector<size_t> final_stops(bus_count);
+            for (size_t& final_stop : final_stops) {
+                final_stop = section.ReadCount();
+                if (final_stop > stops.size()) {
+                    ThrowCorrupted();
+                }
+            }
+            vector<tc::Stop*> bus_stops;
+            for (size_t i = 0; i < bus_count; ++i) {
+                bus_stops.clear();
+                int64_t id = 0;
+                for (size_t j = 0; j < stop_counts[i]; ++j) {
+                    id += section.ReadSigned();
+                    if (id < 0 || static_cast<size_t>(id) >= stops.size()) {
+                        ThrowCorrupted();
+                    }
+                    bus_stops.push_back(stops[id].get());
+                }
+                tcat.AddBus(names[stops.size() + i], bus_stops, is_circle[i]);
+            }
+            section.Finish();
+
+            const auto& buses = tcat.GetAllBuses();
+            for (size_t i = 0; i < bus_count; ++i) {
+                if (final_stops[i] > 0) {
+                    tcat.SetFinalStop(buses[i].get(), stops[final_stops[i] - 1].get());
+                }
+            }
+        }
+
+        tc::NameIndex DecodeNameIndex(istream& input, SectionId id) {
+            SectionReader section(input, id);
+            const uint64_t salt = section.ReadVarint();
+            vector<uint32_t> displacements(section.ReadCount());
+            for (uint32_t& d : displacements) {
+                d = static_cast<uint32_t>(section.ReadCount());
+            }
+            vector<uint32_t> slots(section.ReadCount());
+            for (uint32_t& s : slots) {
+                s = static_cast<uint32_t>(section.ReadCount());
+            }
+            vector<uint32_t> sorted_order(section.ReadCount());
+            for (uint32_t& i : sorted_order) {
+                i = static_cast<uint32_t>(section.ReadCount());
+            }
+            section.Finish();
+            return tc::NameIndex(salt, move(displacements), move(slots), move(sorted_order));
+        }
+
+        tc::PrefixIndex DecodeNamePrefixes(istream& input) {
+            SectionReader section(input, SectionId::NAME_PREFIXES);
+            const size_t size = section.ReadCount();
+            string data = section.ReadBytes();
+            vector<uint32_t> offsets(section.ReadCount());
+            uint32_t offset = 0;
+            for (uint32_t& o : offsets) {
+                offset += static_cast<uint32_t>(section.ReadCount());
+                o = offset;
+            }
+            section.Finish();
+            return tc::PrefixIndex(move(data), move(offsets), size);
+        }
+
+        renderer::MapRenderer DecodeRenderSettings(istream& input) {
+            SectionReader section(input, SectionId::RENDER_SETTINGS);
+            serialize::RenderSettings settings;
+            if (!settings.ParseFromString(section.ReadBytes())) {
+                ThrowCorrupted();
+            }
+            section.Finish();
+            return renderer::MapRenderer(GetRenderSettingsFromDB(settings));
+        }
+
+        tuple<tc::Router, graph::DirectedWeightedGraph<double>, tc::StopIds>
+            DecodeRouter(istream& input, const vector<string_view>& names) {
+            SectionReader section(input, SectionId::ROUTER);
+            serialize::RouterSettings settings;
+            if (!settings.ParseFromString(section.ReadBytes())) {
+                ThrowCorrupted();
+            }
+            tc::Router router(GetRouterSettingsFromDB(settings));
+
+            const size_t vertex_count = section.ReadCount();
+            const size_t edge_count = section.ReadCount();
+            vector<vector<graph::EdgeId>> incidence_lists(vertex_count);
+            vector<graph::VertexId> sources;
+            sources.reserve(edge_count);
+            for (graph::VertexId v = 0; v < vertex_count; ++v) {
+                incidence_lists[v].resize(section.ReadCount());
+                sources.insert(sources.end(), incidence_lists[v].size(), v);
+            }
+            if (sources.size() != edge_count) {
+                ThrowCorrupted();
+            }
+            vector<graph::EdgeId> order(edge_count);
+            vector<bool> seen(edge_count, false);
+            int64_t id = 0;
+            for (graph::EdgeId& e : order) {
+                id += section.ReadSigned();
+                if (id < 0 || static_cast<size_t>(id) >= edge_count || seen[id]) {
+                    ThrowCorrupted();
+                }
+                seen[id] = true;
+                e = static_cast<graph::EdgeId>(id);
+            }
+            size_t k = 0;
+            for (auto& list : incidence_lists) {
+                for (graph::EdgeId& e : list) {
+                    e = order[k++];
+                }
+            }
+
+            vector<graph::Edge<double>> edges(edge_count);
+            for (size_t i = 0; i < edge_count; ++i) {
+                graph::Edge<double>& edge = edges[order[i]];
+                const int64_t to = static_cast<int64_t>(sources[i]) + section.ReadSigned();
+                if (to < 0 || static_cast<size_t>(to) >= vertex_count) {
+                    ThrowCorrupted();
+                }
+                edge.from = sources[i];
+                edge.to = static_cast<graph::VertexId>(to);
+            }
+            for (size_t i = 0; i < edge_count; ++i) {
+                const size_t name = section.ReadCount();
+                if (name >= names.size()) {
+                    ThrowCorrupted();
+                }
+                edges[order[i]].name = string(names[name]);
+            }
+            for (size_t i = 0; i < edge_count; ++i) {
+                edges[order[i]].quality = section.ReadCount();
+            }
+            for (size_t i = 0; i < edge_count; ++i) {
+                edges[order[i]].weight = section.ReadDouble();
+            }
+
+            tc::StopIds stop_ids;
+            vector<string_view> stop_names(section.ReadCount());
+            for (string_view& name : stop_names) {
+                const size_t name_id = section.ReadCount();
+                if (name_id >= names.size()) {
+                    ThrowCorrupted();
+                }
+                name = names[name_id];
+            }
+            int64_t vertex = 0;
+            for (const string_view name : stop_names) {
+                vertex += section.ReadSigned();
+                stop_ids.emplace(name, static_cast<graph::VertexId>(vertex));
+            }
+            section.Finish();
+            return { move(router), graph::DirectedWeightedGraph<double>(move(edges), move(incidence_lists)), move(stop_ids) };
+        }
+
+        renderer::MapText DecodeMap(istream& input) {
+            SectionReader section(input, SectionId::MAP);
+            string svg = section.ReadBytes();
+            string escaped = section.ReadBytes();
+            section.Finish();
+            return renderer::MakeMapText(move(svg), move(escaped));
+        }
+    }
+
+    bool IsCompressedBase(istream& input) {
+        char magic[sizeof(MAGIC)] = {};
+        const auto position = input.tellg();
+        input.read(magic, sizeof(magic));
+        const bool result = input.gcount() == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+        input.clear();
+        input.seekg(position);
+        return result;
+    }
+
+    void Serialize(const tc::Catalogue& tcat,
+        const renderer::MapRenderer& renderer, const tc::Router& router,
+        const optional<renderer::MapText>& map,
+        ostream& output) {
+        FileHeader header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = COMPRESSED_VERSION;
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        NameIds ids;
+        WriteSection(output, SectionId::STRINGS, EncodeStrings(tcat, ids));
+        WriteSection(output, SectionId::STOPS, EncodeStops(tcat));
+        WriteSection(output, SectionId::DISTANCES, EncodeDistances(tcat, ids));
+        WriteSection(output, SectionId::BUSES, EncodeBuses(tcat, ids));
+        WriteSection(output, SectionId::STOP_INDEX, EncodeNameIndex(tcat.GetStopIndex()));
+        WriteSection(output, SectionId::BUS_INDEX, EncodeNameIndex(tcat.GetBusIndex()));
+        WriteSection(output, SectionId::NAME_PREFIXES, EncodeNamePrefixes(tcat.GetNamePrefixes()));
+        SectionBuilder render_settings;
+        render_settings.WriteBytes(GetRenderSettingSerialize(renderer.GetRenderSettings()).SerializeAsString());
+        WriteSection(output, SectionId::RENDER_SETTINGS, render_settings);
+        WriteSection(output, SectionId::ROUTER, EncodeRouter(router, ids));
+        if (map) {
+            SectionBuilder section;
+            section.WriteBytes(map->svg);
+            section.WriteBytes(map->escaped);
+            WriteSection(output, SectionId::MAP, section);
+        }
+    }
+
+    Base Deserialize(istream& input) {
+        FileHeader header;
+        if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != COMPRESSED_VERSION) {
+            ThrowCorrupted();
+        }
+        tc::Catalogue tcat;
+        const vector<string_view> names = DecodeStrings(input, tcat);
+        DecodeStops(input, tcat, names);
+        DecodeDistances(input, tcat);
+        DecodeBuses(input, tcat, names);
+        tcat.SetStopIndex(DecodeNameIndex(input, SectionId::STOP_INDEX));
+        tcat.SetBusIndex(DecodeNameIndex(input, SectionId::BUS_INDEX));
+        tcat.SetNamePrefixes(DecodeNamePrefixes(input));
+        renderer::MapRenderer renderer = DecodeRenderSettings(input);
+        auto [router, graph, stop_ids] = DecodeRouter(input, names);
+        optional<renderer::MapText> map;
+        if (input.peek() != char_traits<char>::eof()) {
+            map = DecodeMap(input);
+        }
+        return { move(tcat), move(renderer), move(router), move(graph), move(stop_ids), move(map) };
+    }
+
+} // namespace compressed
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "serialization.h"
+
+#include <iostream>
+
+// Сжатая база: секции раскладываются по столбцам (сначала все значения одного поля,
+// затем следующего), целые числа пишутся varint-ами от разностей с соседями,
+// и каждая секция отдельно сжимается zlib. Чтение распаковывает секции потоком
+// небольшими порциями сразу в структуры каталога.
+namespace compressed {
+
+    // Проверяет сигнатуру в начале потока; позиция потока возвращается на место
+    bool IsCompressedBase(std::istream& input);
+
+    void Serialize(const tc::Catalogue& tcat,
+        const renderer::MapRenderer& renderer,
+        const tc::Router& router,
+        const std::optional<renderer::MapText>& map,
+        std::ostream& output);
+
+    // Бросает std::runtime_error, если база повреждена
+    Base Deserialize(std::istream& input);
+
+} // namespace compressed
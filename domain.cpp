@@ -3,7 +3,7 @@
 
 namespace domain {
 
-    Stop::Stop(const std::string& name, const geo::Coordinates& coordinates)
+    Stop::Stop(std::string_view name, const geo::Coordinates& coordinates)
         : name(name)
         , coordinates(coordinates) {}
 
@@ -13,7 +13,7 @@ namespace domain {
         else return 0;
     }
 
-    Bus::Bus(const std::string& name, std::vector<Stop*> stops, bool is_circle)
+    Bus::Bus(std::string_view name, std::vector<Stop*> stops, bool is_circle)
         : name(name)
         , stops(stops)
         , is_circle(is_circle)
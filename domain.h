@@ -10,18 +10,20 @@
 namespace domain {
 
     struct Stop {
-        Stop(const std::string& name, const geo::Coordinates& coordinates);
+        Stop(std::string_view name, const geo::Coordinates& coordinates);
         int GetDistance(Stop* to);
 
-        std::string name;
+        // Указывает в хранилище имён каталога
+        std::string_view name;
         geo::Coordinates coordinates;
         std::unordered_map<std::string_view, int> stop_distances;
     };
 
     struct Bus {
-        Bus(const std::string& name, std::vector<Stop*> stops, bool is_circle);
+        Bus(std::string_view name, std::vector<Stop*> stops, bool is_circle);
 
-        std::string name;
+        // Указывает в хранилище имён каталога
+        std::string_view name;
         std::vector<Stop*> stops;
         bool is_circle;
         Stop* final_stop = nullptr;
@@ -0,0 +1,506 @@
+#include "flat_base.h"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace flat {
+
+    namespace {
+        const char MAGIC[8] = { 'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0' };
+        // Записывается в родном порядке байт; на машине с другим порядком не совпадёт
+        const uint32_t BYTE_ORDER_MARK = 0x01020304;
+        // Версия 2: в каталоге секций записаны их CRC32
+        const uint32_t FLAT_VERSION = 2;
+        // Начала секций выровнены, чтобы записи читались прямо из отображения
+        const size_t ALIGNMENT = 8;
+        // Столько рёбер или вершин графа разбирает одна задача пула
+        const size_t GRAPH_CHUNK_SIZE = 4096;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t byte_order;
+            uint32_t version;
+            uint32_t section_count;
+            uint32_t reserved;
+        };
+
+        struct SectionEntry {
+            uint32_t id;
+            uint32_t checksum;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        [[noreturn]] void ThrowCorrupted() {
+            throw runtime_error("Corrupted flat base"s);
+        }
+
+        uint32_t GetChecksum(string_view data) {
+            uLong result = crc32(0, Z_NULL, 0);
+            // crc32 принимает длину типа uInt, поэтому большие секции считаются частями
+            while (!data.empty()) {
+                const size_t n = min<size_t>(data.size(), 1u << 30);
+                result = crc32(result, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(n));
+                data.remove_prefix(n);
+            }
+            return static_cast<uint32_t>(result);
+        }
+
+        size_t AlignUp(size_t offset) {
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+
+        template <typename T>
+        string ToBytes(const vector<T>& items) {
+            return string(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+        }
+
+        template <typename T>
+        string ToBytes(const T& item) {
+            return string(reinterpret_cast<const char*>(&item), sizeof(T));
+        }
+
+        template <typename T>
+        vector<T> ToVector(ArrayView<T> items) {
+            return { items.begin(), items.end() };
+        }
+
+        // Смещения CSR: count + 1 неубывающих значений от 0 до total
+        void CheckOffsets(ArrayView<uint32_t> offsets, size_t count, size_t total) {
+            if (offsets.size() != count + 1 || offsets[0] != 0 || offsets[count] != total) {
+                ThrowCorrupted();
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (offsets[i] > offsets[i + 1]) {
+                    ThrowCorrupted();
+                }
+            }
+        }
+
+        class SectionsWriter {
+        public:
+            void Add(SectionId id, string data) {
+                sections_.emplace_back(id, move(data));
+            }
+
+            void Write(ostream& output) const {
+                FileHeader header{};
+                memcpy(header.magic, MAGIC, sizeof(MAGIC));
+                header.byte_order = BYTE_ORDER_MARK;
+                header.version = FLAT_VERSION;
+                header.section_count = static_cast<uint32_t>(sections_.size());
+
+                vector<SectionEntry> entries;
+                size_t offset = AlignUp(sizeof(FileHeader) + sections_.size() * sizeof(SectionEntry));
+                for (const auto& [id, data] : sections_) {
+                    entries.push_back({ static_cast<uint32_t>(id), GetChecksum(data), offset, data.size() });
+                    offset = AlignUp(offset + data.size());
+                }
+
+                output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SectionEntry));
+                size_t written = sizeof(FileHeader) + entries.size() * sizeof(SectionEntry);
+                const char padding[ALIGNMENT] = {};
+                for (size_t i = 0; i < sections_.size(); ++i) {
+                    output.write(padding, entries[i].offset - written);
+                    output.write(sections_[i].second.data(), sections_[i].second.size());
+                    written = entries[i].offset + sections_[i].second.size();
+                }
+            }
+
+        private:
+            vector<pair<SectionId, string>> sections_;
+        };
+
+        void AddStrings(SectionsWriter& writer, const tc::Catalogue& tcat, NameIds& ids) {
+            vector<uint32_t> offsets{ 0 };
+            string data;
+            const auto add = [&](string_view name) {
+                ids.emplace(name, static_cast<uint32_t>(offsets.size() - 1));
+                data += name;
+                offsets.push_back(static_cast<uint32_t>(data.size()));
+            };
+            // Сначала имена остановок, чтобы номер строки совпадал с номером остановки
+            for (const auto& s : tcat.GetAllStops()) {
+                add(s->name);
+            }
+            for (const auto& b : tcat.GetAllBuses()) {
+                add(b->name);
+            }
+            writer.Add(SectionId::STRING_OFFSETS, ToBytes(offsets));
+            writer.Add(SectionId::STRING_DATA, move(data));
+        }
+
+        void AddStops(SectionsWriter& writer, const tc::Catalogue& tcat, const NameIds& ids) {
+            vector<StopRecord> stops;
+            vector<uint32_t> distance_offsets{ 0 };
+            vector<DistanceRecord> distances;
+            for (const auto& s : tcat.GetAllStops()) {
+                stops.push_back({ s->coordinates.lat, s->coordinates.lng, ids.at(s->name), 0 });
+                for (const auto& [n, d] : s->stop_distances) {
+                    distances.push_back({ ids.at(n), d });
+                }
+                distance_offsets.push_back(static_cast<uint32_t>(distances.size()));
+            }
+            writer.Add(SectionId::STOPS, ToBytes(stops));
+            writer.Add(SectionId::DISTANCE_OFFSETS, ToBytes(distance_offsets));
+            writer.Add(SectionId::DISTANCES, ToBytes(distances));
+        }
+
+        void AddBuses(SectionsWriter& writer, const tc::Catalogue& tcat, const NameIds& ids) {
+            vector<BusRecord> buses;
+            vector<uint32_t> stop_offsets{ 0 };
+            vector<uint32_t> stops;
+            for (const auto& b : tcat.GetAllBuses()) {
+                const uint32_t final_stop = b->final_stop ? ids.at(b->final_stop->name) + 1 : 0;
+                buses.push_back({ ids.at(b->name), final_stop, b->is_circle ? 1u : 0u, 0 });
+                for (const auto& s : b->stops) {
+                    stops.push_back(ids.at(s->name));
+                }
+                stop_offsets.push_back(static_cast<uint32_t>(stops.size()));
+            }
+            writer.Add(SectionId::BUSES, ToBytes(buses));
+            writer.Add(SectionId::BUS_STOP_OFFSETS, ToBytes(stop_offsets));
+            writer.Add(SectionId::BUS_STOPS, ToBytes(stops));
+        }
+
+        void AddIndexes(SectionsWriter& writer, const tc::Catalogue& tcat, Meta& meta) {
+            const tc::NameIndex& stop_index = tcat.GetStopIndex();
+            meta.stop_index_salt = stop_index.GetSalt();
+            writer.Add(SectionId::STOP_INDEX_DISPLACEMENTS, ToBytes(stop_index.GetDisplacements()));
+            writer.Add(SectionId::STOP_INDEX_SLOTS, ToBytes(stop_index.GetSlots()));
+            writer.Add(SectionId::STOP_INDEX_ORDER, ToBytes(stop_index.GetSortedOrder()));
+
+            const tc::NameIndex& bus_index = tcat.GetBusIndex();
+            meta.bus_index_salt = bus_index.GetSalt();
+            writer.Add(SectionId::BUS_INDEX_DISPLACEMENTS, ToBytes(bus_index.GetDisplacements()));
+            writer.Add(SectionId::BUS_INDEX_SLOTS, ToBytes(bus_index.GetSlots()));
+            writer.Add(SectionId::BUS_INDEX_ORDER, ToBytes(bus_index.GetSortedOrder()));
+
+            const tc::SpatialIndex& grid = tcat.GetStopGrid();
+            const tc::SpatialIndex::Layout& layout = grid.GetLayout();
+            meta.grid_min_lat = layout.min.lat;
+            meta.grid_min_lng = layout.min.lng;
+            meta.grid_max_lat = layout.max.lat;
+            meta.grid_max_lng = layout.max.lng;
+            meta.grid_rows = layout.rows;
+            meta.grid_cols = layout.cols;
+            writer.Add(SectionId::GRID_CELL_START, ToBytes(grid.GetCellStart()));
+            writer.Add(SectionId::GRID_ITEMS, ToBytes(grid.GetItems()));
+
+            const tc::PrefixIndex& prefixes = tcat.GetNamePrefixes();
+            meta.prefix_count = prefixes.Size();
+            writer.Add(SectionId::PREFIX_DATA, prefixes.GetData());
+            writer.Add(SectionId::PREFIX_BLOCK_OFFSETS, ToBytes(prefixes.GetBlockOffsets()));
+        }
+
+        void AddRouter(SectionsWriter& writer, const tc::Router& router, const NameIds& ids, Meta& meta) {
+            writer.Add(SectionId::ROUTER_SETTINGS, GetRouterSettingSerialize(router.GetSettings()).SerializeAsString());
+
+            const graph::DirectedWeightedGraph<double>& g = router.GetGraph();
+            meta.vertex_count = g.GetVertexCount();
+            vector<EdgeRecord> edges;
+            edges.reserve(g.GetEdgeCount());
+            for (size_t i = 0; i < g.GetEdgeCount(); ++i) {
+                const graph::Edge<double>& edge = g.GetEdge(i);
+                edges.push_back({ static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to),
+                    ids.at(edge.name), static_cast<uint32_t>(edge.quality), edge.weight });
+            }
+            vector<uint32_t> incidence_offsets{ 0 };
+            vector<uint32_t> incidence;
+            for (size_t i = 0; i < g.GetVertexCount(); ++i) {
+                for (const auto& edge_id : g.GetIncidentEdges(i)) {
+                    incidence.push_back(static_cast<uint32_t>(edge_id));
+                }
+                incidence_offsets.push_back(static_cast<uint32_t>(incidence.size()));
+            }
+            writer.Add(SectionId::EDGES, ToBytes(edges));
+            writer.Add(SectionId::INCIDENCE_OFFSETS, ToBytes(incidence_offsets));
+            writer.Add(SectionId::INCIDENCE, ToBytes(incidence));
+
+            vector<StopIdRecord> stop_ids;
+            for (const auto& [n, id] : router.GetStopIds()) {
+                stop_ids.push_back({ ids.at(n), static_cast<uint32_t>(id) });
+            }
+            writer.Add(SectionId::ROUTE_STOP_IDS, ToBytes(stop_ids));
+        }
+
+        void AddStopsFromBase(tc::Catalogue& tcat, const BaseView& base) {
+            const Meta& meta = base.GetMeta();
+            const ArrayView<StopRecord> stops = base.GetArray<StopRecord>(SectionId::STOPS);
+            for (const StopRecord& s : stops) {
+                tcat.AddStop(base.GetName(s.name), { s.lat, s.lng });
+            }
+            tcat.SetStopIndex(tc::NameIndex(meta.stop_index_salt,
+                ToVector(base.GetArray<uint32_t>(SectionId::STOP_INDEX_DISPLACEMENTS)),
+                ToVector(base.GetArray<uint32_t>(SectionId::STOP_INDEX_SLOTS)),
+                ToVector(base.GetArray<uint32_t>(SectionId::STOP_INDEX_ORDER))));
+
+            tc::SpatialIndex::Layout layout;
+            layout.min = { meta.grid_min_lat, meta.grid_min_lng };
+            layout.max = { meta.grid_max_lat, meta.grid_max_lng };
+            layout.rows = meta.grid_rows;
+            layout.cols = meta.grid_cols;
+            vector<geo::Coordinates> points;
+            points.reserve(stops.size());
+            for (const StopRecord& s : stops) {
+                points.push_back({ s.lat, s.lng });
+            }
+            tcat.SetStopGrid(tc::SpatialIndex(layout,
+                ToVector(base.GetArray<uint32_t>(SectionId::GRID_CELL_START)),
+                ToVector(base.GetArray<uint32_t>(SectionId::GRID_ITEMS)), points));
+
+            const auto& all_stops = tcat.GetAllStops();
+            const ArrayView<uint32_t> offsets = base.GetArray<uint32_t>(SectionId::DISTANCE_OFFSETS);
+            const ArrayView<DistanceRecord> distances = base.GetArray<DistanceRecord>(SectionId::DISTANCES);
+            CheckOffsets(offsets, stops.size(), distances.size());
+            for (size_t i = 0; i < stops.size(); ++i) {
+                for (uint32_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+                    tcat.SetDistance(all_stops[i].get(), all_stops.at(distances[j].to).get(), distances[j].distance);
+                }
+            }
+        }
+
+        void AddBusesFromBase(tc::Catalogue& tcat, const BaseView& base) {
+            const auto& all_stops = tcat.GetAllStops();
+            const ArrayView<BusRecord> buses = base.GetArray<BusRecord>(SectionId::BUSES);
+            const ArrayView<uint32_t> offsets = base.GetArray<uint32_t>(SectionId::BUS_STOP_OFFSETS);
+            const ArrayView<uint32_t> bus_stops = base.GetArray<uint32_t>(SectionId::BUS_STOPS);
+            CheckOffsets(offsets, buses.size(), bus_stops.size());
+            vector<tc::Stop*> stops;
+            for (size_t i = 0; i < buses.size(); ++i) {
+                stops.clear();
+                for (uint32_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+                    stops.push_back(all_stops.at(bus_stops[j]).get());
+                }
+                tcat.AddBus(base.GetName(buses[i].name), stops, buses[i].is_circle != 0);
+            }
+            tcat.SetBusIndex(tc::NameIndex(base.GetMeta().bus_index_salt,
+                ToVector(base.GetArray<uint32_t>(SectionId::BUS_INDEX_DISPLACEMENTS)),
+                ToVector(base.GetArray<uint32_t>(SectionId::BUS_INDEX_SLOTS)),
+                ToVector(base.GetArray<uint32_t>(SectionId::BUS_INDEX_ORDER))));
+
+            const auto& all_buses = tcat.GetAllBuses();
+            for (size_t i = 0; i < buses.size(); ++i) {
+                if (buses[i].final_stop > 0) {
+                    tcat.SetFinalStop(all_buses[i].get(), all_stops.at(buses[i].final_stop - 1).get());
+                }
+            }
+
+            const string_view prefix_data = base.GetBytes(SectionId::PREFIX_DATA);
+            tcat.SetNamePrefixes(tc::PrefixIndex(string(prefix_data),
+                ToVector(base.GetArray<uint32_t>(SectionId::PREFIX_BLOCK_OFFSETS)), base.GetMeta().prefix_count));
+        }
+
+        graph::DirectedWeightedGraph<double> GetGraphFromBase(const BaseView& base) {
+            const size_t vertex_count = base.GetMeta().vertex_count;
+            const ArrayView<EdgeRecord> records = base.GetArray<EdgeRecord>(SectionId::EDGES);
+            const ArrayView<uint32_t> offsets = base.GetArray<uint32_t>(SectionId::INCIDENCE_OFFSETS);
+            const ArrayView<uint32_t> incidence = base.GetArray<uint32_t>(SectionId::INCIDENCE);
+            CheckOffsets(offsets, vertex_count, incidence.size());
+
+            ThreadPool& pool = ThreadPool::GetShared();
+            vector<graph::Edge<double>> edges(records.size());
+            pool.ParallelFor(records.size(), GRAPH_CHUNK_SIZE, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const EdgeRecord& e = records[i];
+                    if (e.from >= vertex_count || e.to >= vertex_count) {
+                        ThrowCorrupted();
+                    }
+                    edges[i] = { string(base.GetName(e.name)), e.quality, e.from, e.to, e.weight };
+                }
+                });
+            vector<vector<graph::EdgeId>> incidence_lists(vertex_count);
+            pool.ParallelFor(vertex_count, GRAPH_CHUNK_SIZE, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    incidence_lists[i].assign(incidence.begin() + offsets[i], incidence.begin() + offsets[i + 1]);
+                    for (const graph::EdgeId id : incidence_lists[i]) {
+                        if (id >= edges.size()) {
+                            ThrowCorrupted();
+                        }
+                    }
+                }
+                });
+            return graph::DirectedWeightedGraph<double>(move(edges), move(incidence_lists));
+        }
+
+        tc::Catalogue LoadCatalogue(const BaseView& base) {
+            tc::Catalogue tcat;
+            tcat.AdoptNames(base.GetFile(), base.GetBytes(SectionId::STRING_DATA));
+            AddStopsFromBase(tcat, base);
+            AddBusesFromBase(tcat, base);
+            return tcat;
+        }
+
+        json::Node GetRenderSettingsFromBase(const BaseView& base) {
+            serialize::RenderSettings settings;
+            const string_view bytes = base.GetBytes(SectionId::RENDER_SETTINGS);
+            if (!settings.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()))) {
+                ThrowCorrupted();
+            }
+            return GetRenderSettingsFromDB(settings);
+        }
+
+        json::Node GetRouterSettingsFromBase(const BaseView& base) {
+            serialize::RouterSettings settings;
+            const string_view bytes = base.GetBytes(SectionId::ROUTER_SETTINGS);
+            if (!settings.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()))) {
+                ThrowCorrupted();
+            }
+            return GetRouterSettingsFromDB(settings);
+        }
+
+        // Текст карты остаётся в отображении, которое удерживает base
+        optional<renderer::MapText> GetMapFromBase(const shared_ptr<const BaseView>& base) {
+            const string_view svg = base->GetBytes(SectionId::MAP_SVG);
+            if (svg.empty()) {
+                return nullopt;
+            }
+            return renderer::MapText{ base, svg, base->GetBytes(SectionId::MAP_ESCAPED) };
+        }
+
+        tc::StopIds GetStopIdsFromBase(const BaseView& base) {
+            tc::StopIds result;
+            for (const StopIdRecord& s : base.GetArray<StopIdRecord>(SectionId::ROUTE_STOP_IDS)) {
+                result.emplace(base.GetName(s.name), s.vertex);
+            }
+            return result;
+        }
+    }
+
+    BaseView::BaseView(shared_ptr<const MappedFile> file)
+        : file_(move(file))
+    {
+        const string_view data = file_->GetData();
+        if (data.size() < sizeof(FileHeader)) {
+            ThrowCorrupted();
+        }
+        FileHeader header;
+        memcpy(&header, data.data(), sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byte_order != BYTE_ORDER_MARK
+            || header.version == 0 || header.version > FLAT_VERSION
+            || header.section_count > (data.size() - sizeof(FileHeader)) / sizeof(SectionEntry)) {
+            ThrowCorrupted();
+        }
+        const auto* entries = reinterpret_cast<const SectionEntry*>(data.data() + sizeof(FileHeader));
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            const SectionEntry& entry = entries[i];
+            if (entry.offset % ALIGNMENT != 0 || entry.offset > data.size() || entry.size > data.size() - entry.offset) {
+                ThrowCorrupted();
+            }
+            // Неизвестные секции пропускаем: их могла записать более новая версия
+            if (entry.id < sections_.size()) {
+                sections_[entry.id] = data.substr(entry.offset, entry.size);
+                checksums_[entry.id] = entry.checksum;
+                // В первой версии контрольных сумм не было
+                verified_[entry.id] = header.version < 2;
+            }
+        }
+        if (GetBytes(SectionId::META).size() != sizeof(Meta)) {
+            ThrowCorrupted();
+        }
+        string_offsets_ = GetArray<uint32_t>(SectionId::STRING_OFFSETS);
+        string_data_ = GetBytes(SectionId::STRING_DATA);
+        if (string_offsets_.size() == 0) {
+            ThrowCorrupted();
+        }
+        CheckOffsets(string_offsets_, string_offsets_.size() - 1, string_data_.size());
+    }
+
+    const shared_ptr<const MappedFile>& BaseView::GetFile() const {
+        return file_;
+    }
+
+    string_view BaseView::GetBytes(SectionId id) const {
+        const size_t i = static_cast<size_t>(id);
+        const string_view result = sections_.at(i);
+        if (!verified_[i] && !result.empty()) {
+            if (GetChecksum(result) != checksums_[i]) {
+                ThrowCorrupted();
+            }
+            verified_[i] = true;
+        }
+        return result;
+    }
+
+    const Meta& BaseView::GetMeta() const {
+        return *reinterpret_cast<const Meta*>(GetBytes(SectionId::META).data());
+    }
+
+    size_t BaseView::GetNameCount() const {
+        return string_offsets_.size() - 1;
+    }
+
+    string_view BaseView::GetName(uint32_t id) const {
+        if (id >= GetNameCount()) {
+            ThrowCorrupted();
+        }
+        return string_data_.substr(string_offsets_[id], string_offsets_[id + 1] - string_offsets_[id]);
+    }
+
+    bool IsFlatBase(istream& input) {
+        char magic[sizeof(MAGIC)] = {};
+        const auto position = input.tellg();
+        input.read(magic, sizeof(magic));
+        const bool result = input.gcount() == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+        input.clear();
+        input.seekg(position);
+        return result;
+    }
+
+    void Serialize(const tc::Catalogue& tcat,
+        const renderer::MapRenderer& renderer, const tc::Router& router,
+        const optional<renderer::MapText>& map,
+        ostream& output) {
+        SectionsWriter writer;
+        Meta meta{};
+        NameIds ids;
+        AddStrings(writer, tcat, ids);
+        AddStops(writer, tcat, ids);
+        AddBuses(writer, tcat, ids);
+        AddIndexes(writer, tcat, meta);
+        writer.Add(SectionId::RENDER_SETTINGS, GetRenderSettingSerialize(renderer.GetRenderSettings()).SerializeAsString());
+        AddRouter(writer, router, ids, meta);
+        if (map) {
+            writer.Add(SectionId::MAP_SVG, string(map->svg));
+            writer.Add(SectionId::MAP_ESCAPED, string(map->escaped));
+        }
+        writer.Add(SectionId::META, ToBytes(meta));
+        writer.Write(output);
+    }
+
+    Base Deserialize(shared_ptr<const MappedFile> file) {
+        auto base = make_shared<const BaseView>(move(file));
+        // Граф от каталога не зависит и разбирается в пуле, пока строится каталог
+        auto graph = ThreadPool::GetShared().Submit([base] { return GetGraphFromBase(*base); });
+        tc::Catalogue tcat = LoadCatalogue(*base);
+        renderer::MapRenderer renderer(GetRenderSettingsFromBase(*base));
+        tc::Router router(GetRouterSettingsFromBase(*base));
+        return { move(tcat), move(renderer), move(router), graph.get(), GetStopIdsFromBase(*base), GetMapFromBase(base) };
+    }
+
+    LoadedBase Open(shared_ptr<const MappedFile> file) {
+        auto base = make_shared<const BaseView>(move(file));
+        return { LoadCatalogue(*base),
+            Lazy<tc::Router>([base] {
+                auto result = make_unique<tc::Router>(GetRouterSettingsFromBase(*base));
+                result->SetGraph(GetGraphFromBase(*base), GetStopIdsFromBase(*base));
+                return result;
+                }),
+            Lazy<renderer::MapRenderer>([base] {
+                return make_unique<renderer::MapRenderer>(GetRenderSettingsFromBase(*base));
+                }),
+            Lazy<optional<renderer::MapText>>([base] {
+                return make_unique<optional<renderer::MapText>>(GetMapFromBase(base));
+                }) };
+    }
+
+} // namespace flat
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "serialization.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+// База в плоском формате: заголовок, каталог секций (смещение, длина и CRC32
+// каждой) и выровненные секции с массивами записей фиксированного размера.
+// Файл отображается в память. Имена каталога и текст карты читаются на месте,
+// остальные секции копируются в каталог, индексы и граф одним проходом по записям
+// без промежуточного разбора. Контрольная сумма секции проверяется при первом
+// обращении к ней.
+namespace flat {
+
+    enum class SectionId : uint32_t {
+        META,
+        STRING_OFFSETS,
+        STRING_DATA,
+        STOPS,
+        DISTANCE_OFFSETS,
+        DISTANCES,
+        BUSES,
+        BUS_STOP_OFFSETS,
+        BUS_STOPS,
+        STOP_INDEX_DISPLACEMENTS,
+        STOP_INDEX_SLOTS,
+        STOP_INDEX_ORDER,
+        BUS_INDEX_DISPLACEMENTS,
+        BUS_INDEX_SLOTS,
+        BUS_INDEX_ORDER,
+        GRID_CELL_START,
+        GRID_ITEMS,
+        PREFIX_DATA,
+        PREFIX_BLOCK_OFFSETS,
+        RENDER_SETTINGS,
+        ROUTER_SETTINGS,
+        EDGES,
+        INCIDENCE_OFFSETS,
+        INCIDENCE,
+        ROUTE_STOP_IDS,
+        // Карта, нарисованная при make_base; секций нет, если её не просили
+        MAP_SVG,
+        MAP_ESCAPED,
+        COUNT
+    };
+
+    // Скалярные параметры базы
+    struct Meta {
+        uint64_t stop_index_salt;
+        uint64_t bus_index_salt;
+        uint64_t prefix_count;
+        uint64_t vertex_count;
+        double grid_min_lat;
+        double grid_min_lng;
+        double grid_max_lat;
+        double grid_max_lng;
+        uint32_t grid_rows;
+        uint32_t grid_cols;
+    };
+
+    struct StopRecord {
+        double lat;
+        double lng;
+        uint32_t name;
+        uint32_t reserved;
+    };
+
+    struct DistanceRecord {
+        uint32_t to;
+        int32_t distance;
+    };
+
+    struct BusRecord {
+        uint32_t name;
+        // Номер конечной остановки плюс один, 0 — конечной нет
+        uint32_t final_stop;
+        uint32_t is_circle;
+        uint32_t reserved;
+    };
+
+    struct EdgeRecord {
+        uint32_t from;
+        uint32_t to;
+        uint32_t name;
+        uint32_t quality;
+        double weight;
+    };
+
+    struct StopIdRecord {
+        uint32_t name;
+        uint32_t vertex;
+    };
+
+    // Массив записей внутри отображённого файла
+    template <typename T>
+    class ArrayView {
+    public:
+        ArrayView() = default;
+        ArrayView(const T* data, size_t size)
+            : data_(data)
+            , size_(size) {}
+
+        const T* begin() const { return data_; }
+        const T* end() const { return data_ + size_; }
+        size_t size() const { return size_; }
+        const T& operator[](size_t i) const { return data_[i]; }
+
+    private:
+        const T* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Проверенный заголовок и секции отображённой базы
+    class BaseView {
+    public:
+        // Бросает std::runtime_error, если файл не является корректной плоской базой
+        explicit BaseView(std::shared_ptr<const MappedFile> file);
+
+        const std::shared_ptr<const MappedFile>& GetFile() const;
+
+        // Пустая строка, если секции нет. Бросает std::runtime_error, если не сошлась контрольная сумма
+        std::string_view GetBytes(SectionId id) const;
+
+        template <typename T>
+        ArrayView<T> GetArray(SectionId id) const;
+
+        const Meta& GetMeta() const;
+
+        size_t GetNameCount() const;
+
+        std::string_view GetName(uint32_t id) const;
+
+    private:
+        std::shared_ptr<const MappedFile> file_;
+        std::array<std::string_view, static_cast<size_t>(SectionId::COUNT)> sections_;
+        std::array<uint32_t, static_cast<size_t>(SectionId::COUNT)> checksums_ = {};
+        // Секции загружаются из разных потоков; повторная проверка одной секции безвредна
+        mutable std::array<std::atomic<bool>, static_cast<size_t>(SectionId::COUNT)> verified_ = {};
+        ArrayView<uint32_t> string_offsets_;
+        std::string_view string_data_;
+    };
+
+    // Проверяет сигнатуру в начале потока; позиция потока возвращается на место
+    bool IsFlatBase(std::istream& input);
+
+    void Serialize(const tc::Catalogue& tcat,
+        const renderer::MapRenderer& renderer,
+        const tc::Router& router,
+        const std::optional<renderer::MapText>& map,
+        std::ostream& output);
+
+    // Имена каталога указывают прямо в отображение, каталог удерживает файл открытым
+    Base Deserialize(std::shared_ptr<const MappedFile> file);
+
+    // Читает только каталог; секции графа и настроек отрисовки трогаются при первом обращении
+    LoadedBase Open(std::shared_ptr<const MappedFile> file);
+
+    template <typename T>
+    ArrayView<T> BaseView::GetArray(SectionId id) const {
+        const std::string_view bytes = GetBytes(id);
+        if (bytes.size() % sizeof(T) != 0) {
+            throw std::runtime_error("Corrupted flat base section");
+        }
+        return { reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T) };
+    }
+
+} // namespace flat
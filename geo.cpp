@@ -5,8 +5,6 @@
 
 namespace geo {
 
-static const int EARTH_RADIUS = 6371000;
-
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     const double dr = M_PI / 180.0;
@@ -48,14 +48,13 @@ namespace graph {
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
         : incidence_lists_(vertex_count) {
-        edges_.reserve(vertex_count * vertex_count);
     }
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(std::vector<Edge<Weight>> edges,
         std::vector<std::vector<EdgeId>> incidence_lists)
-        : edges_(edges)
-        , incidence_lists_(incidence_lists) {}
+        : edges_(std::move(edges))
+        , incidence_lists_(std::move(incidence_lists)) {}
 
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(Edge<Weight>&& edge) {
@@ -1,83 +1,242 @@
 #include "json.h"
 
-#include <iterator>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace json {
 
     namespace {
         using namespace std::literals;
 
-        Node LoadNode(std::istream& input);
-        Node LoadString(std::istream& input);
+        bool IsSpace(char c) {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
+
+        bool IsDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        bool ToInt(const char* begin, const char* end, int& value) {
+            const auto [ptr, ec] = std::from_chars(begin, end, value);
+            return ec == std::errc{} && ptr == end;
+        }
 
-        std::string LoadLiteral(std::istream& input) {
-            std::string s;
-            while (std::isalpha(input.peek())) {
-                s.push_back(static_cast<char>(input.get()));
+        double ToDouble(const char* begin, const char* end) {
+            double value;
+            const auto [ptr, ec] = std::from_chars(begin, end, value);
+            // Денормализованные числа std::stod считал выходом за диапазон, сохраняем это поведение
+            if (ec == std::errc{} && ptr == end && std::fpclassify(value) != FP_SUBNORMAL) {
+                return value;
             }
-            return s;
+            throw ParsingError("Failed to convert "s + std::string(begin, end) + " to number"s);
         }
 
-        Node LoadArray(std::istream& input) {
-            std::vector<Node> result;
+        // Первый непробельный символ в [pos, end)
+        const char* SkipSpaces(const char* pos, const char* end) {
+            if (pos != end && !IsSpace(*pos)) {
+                return pos;
+            }
+#ifdef __SSE2__
+            // Отступы идут длинными сериями, поэтому проверяем по 16 символов разом
+            while (end - pos >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+                // Символы от \t до \r после вычитания \t попадают в [0, 4] без учёта знака
+                const __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8('\t'));
+                const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+                const __m128i is_space = _mm_or_si128(is_control, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+                const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu;
+                if (mask != 0) {
+                    return pos + __builtin_ctz(mask);
+                }
+                pos += 16;
+            }
+#endif
+            while (pos != end && IsSpace(*pos)) {
+                ++pos;
+            }
+            return pos;
+        }
 
-            for (char c; input >> c && c != ']';) {
-                if (c != ',') {
-                    input.putback(c);
+        // Первая кавычка, обратная косая черта или перевод строки в [pos, end)
+        const char* FindStringStop(const char* pos, const char* end) {
+#ifdef __SSE2__
+            while (end - pos >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+                const __m128i stops = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+                const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(stops));
+                if (mask != 0) {
+                    return pos + __builtin_ctz(mask);
                 }
-                result.push_back(LoadNode(input));
+                pos += 16;
             }
-            if (!input) {
-                throw ParsingError("Array parsing error"s);
+#endif
+            while (pos != end && *pos != '"' && *pos != '\\' && *pos != '\n' && *pos != '\r') {
+                ++pos;
             }
-            return Node(std::move(result));
+            return pos;
+        }
+
+        const size_t MIN_ARENA_BLOCK = 4 * 1024;
+
+        // Первый блок арены соразмерен тексту, чтобы документ умещался в несколько блоков
+        std::shared_ptr<Arena> MakeArena(std::string_view text) {
+            return std::make_shared<Arena>(std::max(text.size(), MIN_ARENA_BLOCK));
         }
 
-        Node LoadDict(std::istream& input) {
-            Dict dict;
+        // Разбирает документ из непрерывного буфера, двигая указатель по нему
+        class Parser {
+        public:
+            // Узлы выделяются в arena. При borrow строки без escape-последовательностей
+            // ссылаются на text, иначе копируются в арену
+            Parser(std::string_view text, bool borrow, Arena& arena)
+                : pos_(text.data())
+                , end_(text.data() + text.size())
+                , borrow_(borrow)
+                , arena_(arena) {
+            }
+
+            Node LoadNode() {
+                pos_ = SkipSpaces(pos_, end_);
+                if (pos_ == end_) {
+                    throw ParsingError("Unexpected EOF"s);
+                }
+                switch (*pos_) {
+                case '[':
+                    ++pos_;
+                    return LoadArray();
+                case '{':
+                    ++pos_;
+                    return LoadDict();
+                case '"':
+                    ++pos_;
+                    return LoadString();
+                case 't':
+                    // Встретив t или f, пробуем разобрать литералы true либо false
+                    [[fallthrough]];
+                case 'f':
+                    return LoadBool();
+                case 'n':
+                    return LoadNull();
+                default:
+                    return LoadNumber();
+                }
+            }
+
+        private:
+            const char* pos_;
+            const char* end_;
+            bool borrow_;
+            Arena& arena_;
+            // Элементы и пары незакрытых массивов и словарей
+            std::vector<Node> elements_;
+            std::vector<Dict::value_type> members_;
+
+            std::string_view LoadLiteral() {
+                const char* begin = pos_;
+                while (pos_ != end_ && std::isalpha(static_cast<unsigned char>(*pos_))) {
+                    ++pos_;
+                }
+                return { begin, static_cast<size_t>(pos_ - begin) };
+            }
+
+            Node LoadArray() {
+                // Элементы копятся в общем стеке, и массив в арене выделяется сразу нужного размера
+                const size_t first = elements_.size();
+                while (true) {
+                    pos_ = SkipSpaces(pos_, end_);
+                    if (pos_ == end_) {
+                        throw ParsingError("Array parsing error"s);
+                    }
+                    if (*pos_ == ']') {
+                        ++pos_;
+                        break;
+                    }
+                    if (*pos_ == ',') {
+                        ++pos_;
+                    }
+                    elements_.push_back(LoadNode());
+                }
+                const auto begin = elements_.begin() + first;
+                Array result(std::make_move_iterator(begin), std::make_move_iterator(elements_.end()), &arena_);
+                elements_.erase(begin, elements_.end());
+                return Node(std::move(result));
+            }
 
-            for (char c; input >> c && c != '}';) {
-                if (c == '"') {
-                    std::string key = LoadString(input).AsString();
-                    if (input >> c && c == ':') {
-                        if (dict.find(key) != dict.end()) {
-                            throw ParsingError("Duplicate key '"s + key + "' have been found");
+            Node LoadDict() {
+                const size_t first = members_.size();
+                while (true) {
+                    pos_ = SkipSpaces(pos_, end_);
+                    if (pos_ == end_) {
+                        throw ParsingError("Dictionary parsing error"s);
+                    }
+                    const char c = *pos_++;
+                    if (c == '}') {
+                        break;
+                    }
+                    if (c == '"') {
+                        std::string key = LoadStringValue();
+                        pos_ = SkipSpaces(pos_, end_);
+                        if (pos_ == end_) {
+                            throw ParsingError("Dictionary parsing error"s);
                         }
-                        dict.emplace(std::move(key), LoadNode(input));
+                        if (*pos_ != ':') {
+                            throw ParsingError(": is expected but '"s + *pos_ + "' has been found"s);
+                        }
+                        ++pos_;
+                        Node value = LoadNode();
+                        members_.emplace_back(std::move(key), std::move(value));
                     }
-                    else {
-                        throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                    else if (c != ',') {
+                        throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
                     }
                 }
-                else if (c != ',') {
-                    throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+                Dict dict(&arena_);
+                dict.reserve(members_.size() - first);
+                for (auto it = members_.begin() + first; it != members_.end(); ++it) {
+                    const auto [item, inserted] = dict.try_emplace(std::move(it->first));
+                    if (!inserted) {
+                        throw ParsingError("Duplicate key '"s + item->first + "' have been found");
+                    }
+                    item->second = std::move(it->second);
                 }
+                members_.erase(members_.begin() + first, members_.end());
+                return Node(std::move(dict));
             }
-            if (!input) {
-                throw ParsingError("Dictionary parsing error"s);
+
+            std::string LoadStringValue() {
+                return LoadStringValue(pos_);
             }
-            return Node(std::move(dict));
-        }
 
-        Node LoadString(std::istream& input) {
-            auto it = std::istreambuf_iterator<char>(input);
-            auto end = std::istreambuf_iterator<char>();
-            std::string s;
-            while (true) {
-                if (it == end) {
-                    throw ParsingError("String parsing error");
-                }
-                const char ch = *it;
-                if (ch == '"') {
-                    ++it;
-                    break;
-                }
-                else if (ch == '\\') {
-                    ++it;
-                    if (it == end) {
+            // Символы от begin до текущей позиции уже просмотрены и не содержат особых
+            std::string LoadStringValue(const char* begin) {
+                std::string s(begin, pos_);
+                while (true) {
+                    // Обычные символы копируются целыми кусками до ближайшего особого
+                    const char* stop = FindStringStop(pos_, end_);
+                    s.append(pos_, stop);
+                    pos_ = stop;
+                    if (pos_ == end_) {
+                        throw ParsingError("String parsing error");
+                    }
+                    const char ch = *pos_++;
+                    if (ch == '"') {
+                        break;
+                    }
+                    if (ch != '\\') {
+                        throw ParsingError("Unexpected end of line"s);
+                    }
+                    if (pos_ == end_) {
                         throw ParsingError("String parsing error");
                     }
-                    const char escaped_char = *(it);
+                    const char escaped_char = *pos_++;
                     switch (escaped_char) {
                     case 'n':
                         s.push_back('\n');
@@ -98,186 +257,496 @@ namespace json {
                         throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
                     }
                 }
-                else if (ch == '\n' || ch == '\r') {
-                    throw ParsingError("Unexpected end of line"s);
-                }
-                else {
-                    s.push_back(ch);
+                return s;
+            }
+
+            Node LoadString() {
+                const char* begin = pos_;
+                pos_ = FindStringStop(pos_, end_);
+                if (pos_ != end_ && *pos_ == '"') {
+                    ++pos_;
+                    const std::string_view value(begin, static_cast<size_t>(pos_ - 1 - begin));
+                    return Node(StringRef{ borrow_ ? value : Store(value) });
                 }
-                ++it;
+                return Node(StringRef{ Store(LoadStringValue(begin)) });
             }
 
-            return Node(std::move(s));
-        }
+            std::string_view Store(std::string_view value) {
+                if (value.empty()) {
+                    return {};
+                }
+                char* data = static_cast<char*>(arena_.allocate(value.size(), 1));
+                std::copy(value.begin(), value.end(), data);
+                return { data, value.size() };
+            }
 
-        Node LoadBool(std::istream& input) {
-            const auto s = LoadLiteral(input);
-            if (s == "true"sv) {
-                return Node{ true };
+            Node LoadBool() {
+                const auto s = LoadLiteral();
+                if (s == "true"sv) {
+                    return Node{ true };
+                }
+                else if (s == "false"sv) {
+                    return Node{ false };
+                }
+                else {
+                    throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+                }
             }
-            else if (s == "false"sv) {
-                return Node{ false };
+
+            Node LoadNull() {
+                if (auto literal = LoadLiteral(); literal == "null"sv) {
+                    return Node{ nullptr };
+                }
+                else {
+                    throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+                }
             }
-            else {
-                throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+
+            Node LoadNumber() {
+                const char* begin = pos_;
+
+                // Пропускает одну или более цифр
+                auto read_digits = [this] {
+                    if (pos_ == end_ || !IsDigit(*pos_)) {
+                        throw ParsingError("A digit is expected"s);
+                    }
+                    while (pos_ != end_ && IsDigit(*pos_)) {
+                        ++pos_;
+                    }
+                };
+                auto next_is = [this](char c) {
+                    return pos_ != end_ && *pos_ == c;
+                };
+
+                if (next_is('-')) {
+                    ++pos_;
+                }
+                // Парсим целую часть числа
+                if (next_is('0')) {
+                    ++pos_;
+                    // После 0 в JSON не могут идти другие цифры
+                }
+                else {
+                    read_digits();
+                }
+
+                bool is_int = true;
+                // Парсим дробную часть числа
+                if (next_is('.')) {
+                    ++pos_;
+                    read_digits();
+                    is_int = false;
+                }
+
+                // Парсим экспоненциальную часть числа
+                if (next_is('e') || next_is('E')) {
+                    ++pos_;
+                    if (next_is('+') || next_is('-')) {
+                        ++pos_;
+                    }
+                    read_digits();
+                    is_int = false;
+                }
+
+                // Сначала пробуем преобразовать строку в int, при переполнении берём double
+                int value;
+                if (is_int && ToInt(begin, pos_, value)) {
+                    return value;
+                }
+                return ToDouble(begin, pos_);
             }
-        }
+        };
 
-        Node LoadNull(std::istream& input) {
-            if (auto literal = LoadLiteral(input); literal == "null"sv) {
-                return Node{ nullptr };
+        // Разбирает документ, сообщая о его элементах обработчику. Вход либо лежит
+        // в памяти целиком, либо подкачивается из потока порциями по CHUNK_SIZE
+        class SaxParser {
+        public:
+            SaxParser(std::string_view text, Handler& handler)
+                : pos_(text.data())
+                , end_(text.data() + text.size())
+                , handler_(handler) {
             }
-            else {
-                throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+
+            SaxParser(std::istream& input, Handler& handler)
+                : input_(&input)
+                , buffer_(CHUNK_SIZE)
+                , handler_(handler) {
             }
-        }
 
-        Node LoadNumber(std::istream& input) {
-            std::string parsed_num;
+            void ParseValue() {
+                if (!SkipSpacesAndFill()) {
+                    throw ParsingError("Unexpected EOF"s);
+                }
+                switch (*pos_) {
+                case '[':
+                    ++pos_;
+                    ParseArray();
+                    break;
+                case '{':
+                    ++pos_;
+                    ParseDict();
+                    break;
+                case '"':
+                    ++pos_;
+                    handler_.OnString(ReadString());
+                    break;
+                case 't':
+                    [[fallthrough]];
+                case 'f':
+                    ParseBool();
+                    break;
+                case 'n':
+                    ParseNull();
+                    break;
+                default:
+                    ParseNumber();
+                }
+            }
 
-            // Считывает в parsed_num очередной символ из input
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
+        private:
+            static const size_t CHUNK_SIZE = 64 * 1024;
+
+            std::istream* input_ = nullptr;
+            std::vector<char> buffer_;
+            const char* pos_ = nullptr;
+            const char* end_ = nullptr;
+            Handler& handler_;
+            // Строки и числа, разорванные границей порции или содержащие escape-последовательности
+            std::string scratch_;
+            std::string key_;
+
+            // Подкачивает следующую порцию, если текущая кончилась; false в конце ввода
+            bool Fill() {
+                if (pos_ != end_) {
+                    return true;
+                }
+                if (!input_) {
+                    return false;
                 }
-            };
+                input_->read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+                pos_ = buffer_.data();
+                end_ = pos_ + input_->gcount();
+                return pos_ != end_;
+            }
 
-            // Считывает одну или более цифр в parsed_num из input
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
-                    throw ParsingError("A digit is expected"s);
+            bool SkipSpacesAndFill() {
+                while (true) {
+                    pos_ = SkipSpaces(pos_, end_);
+                    if (pos_ != end_) {
+                        return true;
+                    }
+                    if (!Fill()) {
+                        return false;
+                    }
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+            }
+
+            bool NextIs(char c) {
+                return Fill() && *pos_ == c;
+            }
+
+            bool NextIsDigit() {
+                return Fill() && IsDigit(*pos_);
+            }
+
+            void ParseArray() {
+                handler_.OnStartArray();
+                while (true) {
+                    if (!SkipSpacesAndFill()) {
+                        throw ParsingError("Array parsing error"s);
+                    }
+                    if (*pos_ == ']') {
+                        ++pos_;
+                        break;
+                    }
+                    if (*pos_ == ',') {
+                        ++pos_;
+                    }
+                    ParseValue();
                 }
-            };
+                handler_.OnEndArray();
+            }
 
-            if (input.peek() == '-') {
-                read_char();
+            void ParseDict() {
+                handler_.OnStartDict();
+                while (true) {
+                    if (!SkipSpacesAndFill()) {
+                        throw ParsingError("Dictionary parsing error"s);
+                    }
+                    const char c = *pos_++;
+                    if (c == '}') {
+                        break;
+                    }
+                    if (c == '"') {
+                        // Поиск двоеточия может подкачать буфер, на который указывает ключ
+                        key_.assign(ReadString());
+                        if (!SkipSpacesAndFill()) {
+                            throw ParsingError("Dictionary parsing error"s);
+                        }
+                        if (*pos_ != ':') {
+                            throw ParsingError(": is expected but '"s + *pos_ + "' has been found"s);
+                        }
+                        ++pos_;
+                        handler_.OnKey(key_);
+                        ParseValue();
+                    }
+                    else if (c != ',') {
+                        throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+                    }
+                }
+                handler_.OnEndDict();
             }
-            // Парсим целую часть числа
-            if (input.peek() == '0') {
-                read_char();
-                // После 0 в JSON не могут идти другие цифры
+
+            // Результат действителен до следующего чтения
+            std::string_view ReadString() {
+                const char* begin = pos_;
+                pos_ = FindStringStop(pos_, end_);
+                if (pos_ != end_ && *pos_ == '"') {
+                    ++pos_;
+                    return { begin, static_cast<size_t>(pos_ - 1 - begin) };
+                }
+                scratch_.assign(begin, pos_);
+                while (true) {
+                    if (!Fill()) {
+                        throw ParsingError("String parsing error");
+                    }
+                    const char* stop = FindStringStop(pos_, end_);
+                    scratch_.append(pos_, stop);
+                    pos_ = stop;
+                    if (pos_ == end_) {
+                        continue;
+                    }
+                    const char ch = *pos_++;
+                    if (ch == '"') {
+                        return scratch_;
+                    }
+                    if (ch != '\\') {
+                        throw ParsingError("Unexpected end of line"s);
+                    }
+                    if (!Fill()) {
+                        throw ParsingError("String parsing error");
+                    }
+                    const char escaped_char = *pos_++;
+                    switch (escaped_char) {
+                    case 'n':
+                        scratch_.push_back('\n');
+                        break;
+                    case 't':
+                        scratch_.push_back('\t');
+                        break;
+                    case 'r':
+                        scratch_.push_back('\r');
+                        break;
+                    case '"':
+                        scratch_.push_back('"');
+                        break;
+                    case '\\':
+                        scratch_.push_back('\\');
+                        break;
+                    default:
+                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                    }
+                }
             }
-            else {
-                read_digits();
+
+            std::string_view ReadLiteral() {
+                scratch_.clear();
+                while (Fill() && std::isalpha(static_cast<unsigned char>(*pos_))) {
+                    scratch_.push_back(*pos_++);
+                }
+                return scratch_;
             }
 
-            bool is_int = true;
-            // Парсим дробную часть числа
-            if (input.peek() == '.') {
-                read_char();
-                read_digits();
-                is_int = false;
+            void ParseBool() {
+                const auto s = ReadLiteral();
+                if (s == "true"sv) {
+                    handler_.OnBool(true);
+                }
+                else if (s == "false"sv) {
+                    handler_.OnBool(false);
+                }
+                else {
+                    throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+                }
             }
 
-            // Парсим экспоненциальную часть числа
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+            void ParseNull() {
+                if (auto literal = ReadLiteral(); literal == "null"sv) {
+                    handler_.OnNull();
+                }
+                else {
+                    throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
                 }
-                read_digits();
-                is_int = false;
             }
 
-            try {
-                if (is_int) {
-                    // Сначала пробуем преобразовать строку в int
-                    try {
-                        return std::stoi(parsed_num);
+            void ParseNumber() {
+                scratch_.clear();
+                auto take = [this] {
+                    scratch_.push_back(*pos_++);
+                };
+                auto read_digits = [this, take] {
+                    if (!NextIsDigit()) {
+                        throw ParsingError("A digit is expected"s);
                     }
-                    catch (...) {
-                        // В случае неудачи, например, при переполнении
-                        // код ниже попробует преобразовать строку в double
+                    while (NextIsDigit()) {
+                        take();
                     }
+                };
+
+                if (NextIs('-')) {
+                    take();
+                }
+                if (NextIs('0')) {
+                    take();
+                }
+                else {
+                    read_digits();
+                }
+                bool is_int = true;
+                if (NextIs('.')) {
+                    take();
+                    read_digits();
+                    is_int = false;
+                }
+                if (NextIs('e') || NextIs('E')) {
+                    take();
+                    if (NextIs('+') || NextIs('-')) {
+                        take();
+                    }
+                    read_digits();
+                    is_int = false;
+                }
+
+                const char* begin = scratch_.data();
+                const char* end = begin + scratch_.size();
+                int value;
+                if (is_int && ToInt(begin, end, value)) {
+                    handler_.OnInt(value);
+                }
+                else {
+                    handler_.OnDouble(ToDouble(begin, end));
                 }
-                return std::stod(parsed_num);
             }
-            catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+        };
+
+        // Текст копится в data и уходит в поток крупными порциями
+        class OutputBuffer {
+        public:
+            static const size_t CHUNK_SIZE = 64 * 1024;
+
+            OutputBuffer(std::string& data, std::ostream& out)
+                : data_(data)
+                , out_(&out) {
             }
-        }
 
-        Node LoadNode(std::istream& input) {
-            char c;
-            if (!(input >> c)) {
-                throw ParsingError("Unexpected EOF"s);
-            }
-            switch (c) {
-            case '[':
-                return LoadArray(input);
-            case '{':
-                return LoadDict(input);
-            case '"':
-                return LoadString(input);
-            case 't':
-                // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-                // подсказкой компилятору и человеку, что здесь программист явно задумывал
-                // разрешить переход к инструкции следующей ветки case, а не случайно забыл
-                // написать break, return или throw.
-                // В данном случае, встретив t или f, переходим к попытке парсинга
-                // литералов true либо false
-                [[fallthrough]];
-            case 'f':
-                input.putback(c);
-                return LoadBool(input);
-            case 'n':
-                input.putback(c);
-                return LoadNull(input);
-            default:
-                input.putback(c);
-                return LoadNumber(input);
+            // Без потока текст только копится в data
+            explicit OutputBuffer(std::string& data)
+                : data_(data) {
             }
-        }
+
+            void Put(char c) {
+                data_.push_back(c);
+            }
+
+            void Write(std::string_view text) {
+                data_.append(text);
+            }
+
+            // Сбрасывает накопленное, если набралась порция
+            void Commit() {
+                if (out_ && data_.size() >= CHUNK_SIZE) {
+                    Flush();
+                }
+            }
+
+            void Flush() {
+                out_->write(data_.data(), static_cast<std::streamsize>(data_.size()));
+                data_.clear();
+            }
+
+        private:
+            std::string& data_;
+            std::ostream* out_ = nullptr;
+        };
 
         struct PrintContext {
-            std::ostream& out;
+            OutputBuffer& out;
             int indent_step = 4;
             int indent = 0;
+            bool compact = false;
+            int precision = 6;
 
             void PrintIndent() const {
-                for (int i = 0; i < indent; ++i) {
-                    out.put(' ');
+                if (!compact) {
+                    for (int i = 0; i < indent; ++i) {
+                        out.Put(' ');
+                    }
+                }
+            }
+
+            void PrintNewLine() const {
+                if (!compact) {
+                    out.Put('\n');
                 }
             }
 
             PrintContext Indented() const {
-                return { out, indent_step, indent_step + indent };
+                return { out, indent_step, indent_step + indent, compact, precision };
             }
         };
 
+        PrintContext MakeContext(OutputBuffer& out, const PrintSettings& settings) {
+            return { out, 4, 0, settings.style == PrintStyle::COMPACT, settings.precision };
+        }
+
         void PrintNode(const Node& value, const PrintContext& ctx);
 
         template <typename Value>
-        void PrintValue(const Value& value, const PrintContext& ctx) {
-            ctx.out << value;
+        void PrintValue(const Value& value, const PrintContext& ctx);
+
+        template <>
+        void PrintValue<int>(const int& value, const PrintContext& ctx) {
+            char buffer[16];
+            const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            ctx.out.Write({ buffer, static_cast<size_t>(end - buffer) });
         }
 
-        void PrintString(const std::string& value, std::ostream& out) {
-            out.put('"');
+        // Формат general совпадает с выводом std::ostream с той же точностью
+        template <>
+        void PrintValue<double>(const double& value, const PrintContext& ctx) {
+            char buffer[64];
+            const auto [end, ec] = ctx.precision == PrintSettings::SHORTEST
+                ? std::to_chars(buffer, buffer + sizeof(buffer), value)
+                : std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, ctx.precision);
+            ctx.out.Write({ buffer, static_cast<size_t>(end - buffer) });
+        }
+
+        void EscapeString(std::string_view value, OutputBuffer& out) {
             for (const char c : value) {
                 switch (c) {
                 case '\r':
-                    out << "\\r"sv;
+                    out.Write("\\r"sv);
                     break;
                 case '\n':
-                    out << "\\n"sv;
+                    out.Write("\\n"sv);
                     break;
                 case '"':
                     // Символы " и \ выводятся как \" или \\, соответственно
                     [[fallthrough]];
                 case '\\':
-                    out.put('\\');
+                    out.Put('\\');
                     [[fallthrough]];
                 default:
-                    out.put(c);
+                    out.Put(c);
                     break;
                 }
             }
-            out.put('"');
+        }
+
+        void PrintString(std::string_view value, OutputBuffer& out) {
+            out.Put('"');
+            EscapeString(value, out);
+            out.Put('"');
         }
 
         template <>
@@ -285,9 +754,20 @@ namespace json {
             PrintString(value, ctx.out);
         }
 
+        template <>
+        void PrintValue<StringRef>(const StringRef& value, const PrintContext& ctx) {
+            if (value.escaped.empty()) {
+                PrintString(value.value, ctx.out);
+                return;
+            }
+            ctx.out.Put('"');
+            ctx.out.Write(value.escaped);
+            ctx.out.Put('"');
+        }
+
         template <>
         void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-            ctx.out << "null"sv;
+            ctx.out.Write("null"sv);
         }
 
         // В специализаци шаблона PrintValue для типа bool параметр value передаётся
@@ -296,13 +776,14 @@ namespace json {
         // void PrintValue(bool value, const PrintContext& ctx);
         template <>
         void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-            ctx.out << (value ? "true"sv : "false"sv);
+            ctx.out.Write(value ? "true"sv : "false"sv);
         }
 
         template <>
         void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-            std::ostream& out = ctx.out;
-            out << "[\n"sv;
+            OutputBuffer& out = ctx.out;
+            out.Put('[');
+            ctx.PrintNewLine();
             bool first = true;
             auto inner_ctx = ctx.Indented();
             for (const Node& node : nodes) {
@@ -310,20 +791,23 @@ namespace json {
                     first = false;
                 }
                 else {
-                    out << ",\n"sv;
+                    out.Put(',');
+                    ctx.PrintNewLine();
                 }
                 inner_ctx.PrintIndent();
                 PrintNode(node, inner_ctx);
+                out.Commit();
             }
-            out.put('\n');
+            ctx.PrintNewLine();
             ctx.PrintIndent();
-            out.put(']');
+            out.Put(']');
         }
 
         template <>
         void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-            std::ostream& out = ctx.out;
-            out << "{\n"sv;
+            OutputBuffer& out = ctx.out;
+            out.Put('{');
+            ctx.PrintNewLine();
             bool first = true;
             auto inner_ctx = ctx.Indented();
             for (const auto& [key, node] : nodes) {
@@ -331,16 +815,18 @@ namespace json {
                     first = false;
                 }
                 else {
-                    out << ",\n"sv;
+                    out.Put(',');
+                    ctx.PrintNewLine();
                 }
                 inner_ctx.PrintIndent();
                 PrintString(key, ctx.out);
-                out << ": "sv;
+                out.Write(ctx.compact ? ":"sv : ": "sv);
                 PrintNode(node, inner_ctx);
+                out.Commit();
             }
-            out.put('\n');
+            ctx.PrintNewLine();
             ctx.PrintIndent();
-            out.put('}');
+            out.Put('}');
         }
 
         void PrintNode(const Node& node, const PrintContext& ctx) {
@@ -353,12 +839,178 @@ namespace json {
 
     }  // namespace
 
+    Dict::Dict(std::initializer_list<value_type> items) {
+        items_.reserve(items.size());
+        for (const auto& [key, value] : items) {
+            emplace(key, value);
+        }
+    }
+
     Document Load(std::istream& input) {
-        return Document{ LoadNode(input) };
+        std::string text;
+        char buffer[1 << 16];
+        while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+            text.append(buffer, static_cast<size_t>(input.gcount()));
+        }
+        return Load(text);
+    }
+
+    Document Load(std::string_view text) {
+        auto arena = MakeArena(text);
+        Node root = Parser(text, false, *arena).LoadNode();
+        return Document{ std::move(root), std::move(arena) };
+    }
+
+    Document LoadBorrowed(std::shared_ptr<const void> owner, std::string_view text) {
+        auto arena = MakeArena(text);
+        Node root = Parser(text, true, *arena).LoadNode();
+        return Document{ std::move(root), std::move(arena), std::move(owner), text };
+    }
+
+    void Parse(std::istream& input, Handler& handler) {
+        SaxParser(input, handler).ParseValue();
+    }
+
+    void Parse(std::string_view text, Handler& handler) {
+        SaxParser(text, handler).ParseValue();
+    }
+
+    void NodeCollector::OnNull() {
+        Add(Node(nullptr));
+    }
+
+    void NodeCollector::OnBool(bool value) {
+        Add(Node(value));
+    }
+
+    void NodeCollector::OnInt(int value) {
+        Add(Node(value));
+    }
+
+    void NodeCollector::OnDouble(double value) {
+        Add(Node(value));
+    }
+
+    void NodeCollector::OnString(std::string_view value) {
+        Add(Node(std::string(value)));
+    }
+
+    void NodeCollector::OnStartArray() {
+        stack_.emplace_back();
+    }
+
+    void NodeCollector::OnEndArray() {
+        Node node(std::move(stack_.back().array));
+        stack_.pop_back();
+        Add(std::move(node));
+    }
+
+    void NodeCollector::OnStartDict() {
+        stack_.emplace_back().is_dict = true;
+    }
+
+    void NodeCollector::OnKey(std::string_view key) {
+        stack_.back().key.assign(key);
+    }
+
+    void NodeCollector::OnEndDict() {
+        Node node(std::move(stack_.back().dict));
+        stack_.pop_back();
+        Add(std::move(node));
+    }
+
+    bool NodeCollector::IsComplete() const {
+        return root_.has_value();
+    }
+
+    Node NodeCollector::Extract() {
+        Node result = std::move(*root_);
+        root_.reset();
+        return result;
+    }
+
+    void NodeCollector::Add(Node node) {
+        if (stack_.empty()) {
+            root_ = std::move(node);
+            return;
+        }
+        Frame& frame = stack_.back();
+        if (!frame.is_dict) {
+            frame.array.push_back(std::move(node));
+            return;
+        }
+        const auto [it, inserted] = frame.dict.try_emplace(std::move(frame.key));
+        if (!inserted) {
+            throw ParsingError("Duplicate key '"s + it->first + "' have been found");
+        }
+        it->second = std::move(node);
+    }
+
+    void Print(const Document& doc, std::ostream& output, const PrintSettings& settings) {
+        std::string data;
+        OutputBuffer out(data, output);
+        PrintNode(doc.GetRoot(), MakeContext(out, settings));
+        out.Flush();
+    }
+
+    std::string Escape(std::string_view value) {
+        std::string data;
+        OutputBuffer out(data);
+        EscapeString(value, out);
+        return data;
+    }
+
+    ArrayWriter::ArrayWriter(std::ostream& output, const PrintSettings& settings)
+        : output_(output)
+        , settings_(settings) {
+        OutputBuffer out(buffer_, output_);
+        const PrintContext ctx = MakeContext(out, settings_);
+        out.Put('[');
+        ctx.PrintNewLine();
+    }
+
+    void ArrayWriter::Add(const Node& node) {
+        StartElement();
+        OutputBuffer out(buffer_, output_);
+        const PrintContext inner_ctx = MakeContext(out, settings_).Indented();
+        inner_ctx.PrintIndent();
+        PrintNode(node, inner_ctx);
+        out.Commit();
+    }
+
+    void ArrayWriter::AddPrinted(std::string_view element) {
+        StartElement();
+        OutputBuffer out(buffer_, output_);
+        out.Write(element);
+        out.Commit();
+    }
+
+    std::string ArrayWriter::PrintElement(const Node& node, const PrintSettings& settings) {
+        std::string data;
+        OutputBuffer out(data);
+        const PrintContext inner_ctx = MakeContext(out, settings).Indented();
+        inner_ctx.PrintIndent();
+        PrintNode(node, inner_ctx);
+        return data;
+    }
+
+    void ArrayWriter::StartElement() {
+        if (first_) {
+            first_ = false;
+            return;
+        }
+        OutputBuffer out(buffer_, output_);
+        const PrintContext ctx = MakeContext(out, settings_);
+        out.Put(',');
+        ctx.PrintNewLine();
     }
 
-    void Print(const Document& doc, std::ostream& output) {
-        PrintNode(doc.GetRoot(), PrintContext{ output });
+    void ArrayWriter::Finish() {
+        OutputBuffer out(buffer_, output_);
+        const PrintContext ctx = MakeContext(out, settings_);
+        ctx.PrintNewLine();
+        out.Put(']');
+        out.Flush();
     }
 
 }  // namespace json
\ No newline at end of file
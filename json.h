@@ -1,8 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <initializer_list>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 #include <utility>
@@ -10,8 +16,67 @@
 namespace json {
 
     class Node;
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
+    // Массив выделяет память из ресурса, с которым создан: по умолчанию из кучи,
+    // у разобранных документов — из их арены
+    using Array = std::pmr::vector<Node>;
+
+    // Монотонная арена документа: память выдаётся сдвигом указателя и возвращается
+    // целиком при уничтожении арены
+    using Arena = std::pmr::monotonic_buffer_resource;
+
+    // Словарь хранится массивом пар, отсортированным по ключу: одна аллокация на весь
+    // словарь вместо узла дерева на каждый элемент. Интерфейс — подмножество std::map.
+    // Ключи запросов и ответов короткие и помещаются в буфер малой строки std::string
+    class Dict {
+    public:
+        using value_type = std::pair<std::string, Node>;
+        using iterator = std::pmr::vector<value_type>::iterator;
+        using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+        Dict() = default;
+        explicit Dict(std::pmr::memory_resource* resource);
+        // Из повторяющихся ключей, как и в std::map, остаётся первый
+        Dict(std::initializer_list<value_type> items);
+
+        iterator begin();
+        iterator end();
+        const_iterator begin() const;
+        const_iterator end() const;
+        size_t size() const;
+        bool empty() const;
+
+        iterator find(std::string_view key);
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+        // Бросает std::out_of_range, если ключа нет
+        Node& at(std::string_view key);
+        const Node& at(std::string_view key) const;
+        Node& operator[](std::string_view key);
+
+        // Вставляет пару, если ключа ещё нет; ключи, идущие по возрастанию, добавляются в конец
+        std::pair<iterator, bool> try_emplace(std::string key);
+        std::pair<iterator, bool> emplace(std::string key, Node value);
+
+        void reserve(size_t size);
+
+    private:
+        std::pmr::vector<value_type> items_;
+
+        iterator LowerBound(std::string_view key);
+    };
+
+    bool operator==(const Dict& lhs, const Dict& rhs);
+
+    // Строка, символы которой лежат в арене или внешнем буфере документа, см. Load и LoadBorrowed
+    struct StringRef {
+        std::string_view value;
+        // Если не пусто — value, заранее экранированная через Escape; выводится как есть
+        std::string_view escaped = {};
+    };
+
+    inline bool operator==(StringRef lhs, StringRef rhs) {
+        return lhs.value == rhs.value;
+    }
 
     class ParsingError : public std::runtime_error {
     public:
@@ -19,7 +84,7 @@ namespace json {
     };
 
     class Node final
-        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string, StringRef> {
     public:
         using variant::variant;
         using Value = variant;
@@ -78,15 +143,18 @@ namespace json {
         }
 
         bool IsString() const {
-            return std::holds_alternative<std::string>(*this);
+            return std::holds_alternative<std::string>(*this) || std::holds_alternative<StringRef>(*this);
         }
-        const std::string& AsString() const {
+        // Строка живёт, пока жив узел, а для разобранных документов — пока жив сам документ
+        std::string_view AsString() const {
             using namespace std::literals;
-            if (!IsString()) {
-                throw std::logic_error("Not a string"s);
+            if (const auto* owned = std::get_if<std::string>(&GetValue())) {
+                return *owned;
             }
-
-            return std::get<std::string>(*this);
+            if (const auto* ref = std::get_if<StringRef>(&GetValue())) {
+                return ref->value;
+            }
+            throw std::logic_error("Not a string"s);
         }
 
         bool IsDict() const {
@@ -101,31 +169,177 @@ namespace json {
             return std::get<Dict>(*this);
         }
 
+        // Собственная строка и строка из буфера равны, если совпадают символы
         bool operator==(const Node& rhs) const {
+            if (IsString() && rhs.IsString()) {
+                return AsString() == rhs.AsString();
+            }
             return GetValue() == rhs.GetValue();
         }
 
         const Value& GetValue() const {
             return *this;
         }
+        Value& GetValue() {
+            return *this;
+        }
     };
 
     inline bool operator!=(const Node& lhs, const Node& rhs) {
         return !(lhs == rhs);
     }
 
+    inline Dict::Dict(std::pmr::memory_resource* resource)
+        : items_(resource) {
+    }
+
+    inline Dict::iterator Dict::begin() {
+        return items_.begin();
+    }
+
+    inline Dict::iterator Dict::end() {
+        return items_.end();
+    }
+
+    inline Dict::const_iterator Dict::begin() const {
+        return items_.begin();
+    }
+
+    inline Dict::const_iterator Dict::end() const {
+        return items_.end();
+    }
+
+    inline size_t Dict::size() const {
+        return items_.size();
+    }
+
+    inline bool Dict::empty() const {
+        return items_.empty();
+    }
+
+    inline Dict::iterator Dict::LowerBound(std::string_view key) {
+        return std::lower_bound(items_.begin(), items_.end(), key,
+            [](const value_type& item, std::string_view k) { return item.first < k; });
+    }
+
+    inline Dict::iterator Dict::find(std::string_view key) {
+        const auto it = LowerBound(key);
+        return it != items_.end() && it->first == key ? it : items_.end();
+    }
+
+    inline Dict::const_iterator Dict::find(std::string_view key) const {
+        return const_cast<Dict*>(this)->find(key);
+    }
+
+    inline size_t Dict::count(std::string_view key) const {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    inline Node& Dict::at(std::string_view key) {
+        using namespace std::literals;
+        const auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("No key '"s + std::string(key) + "' in dict"s);
+        }
+        return it->second;
+    }
+
+    inline const Node& Dict::at(std::string_view key) const {
+        return const_cast<Dict*>(this)->at(key);
+    }
+
+    inline Node& Dict::operator[](std::string_view key) {
+        return try_emplace(std::string(key)).first->second;
+    }
+
+    inline std::pair<Dict::iterator, bool> Dict::try_emplace(std::string key) {
+        if (items_.empty() || items_.back().first < key) {
+            items_.emplace_back(std::move(key), Node{});
+            return { items_.end() - 1, true };
+        }
+        const auto it = LowerBound(key);
+        if (it != items_.end() && it->first == key) {
+            return { it, false };
+        }
+        return { items_.emplace(it, std::move(key), Node{}), true };
+    }
+
+    inline std::pair<Dict::iterator, bool> Dict::emplace(std::string key, Node value) {
+        auto result = try_emplace(std::move(key));
+        if (result.second) {
+            result.first->second = std::move(value);
+        }
+        return result;
+    }
+
+    inline void Dict::reserve(size_t size) {
+        items_.reserve(size);
+    }
+
+    inline bool operator==(const Dict& lhs, const Dict& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    // Узлы документа, собранного в арене, живут, пока жив документ: скопированные из него
+    // узлы переносятся в кучу, но их строки по-прежнему ссылаются в арену
     class Document {
     public:
         explicit Document(Node root)
             : root_(std::move(root)) {
         }
 
+        // Массивы, словари и строки root могут лежать в arena, а строки — ещё и в buffer,
+        // который удерживает owner
+        Document(Node root, std::shared_ptr<Arena> arena,
+            std::shared_ptr<const void> owner = nullptr, std::string_view buffer = {})
+            : arena_(std::move(arena))
+            , root_(std::move(root))
+            , owner_(std::move(owner))
+            , buffer_(buffer) {
+        }
+
+        Document(const Document&) = default;
+        Document(Document&&) = default;
+
+        Document& operator=(const Document& other) {
+            return *this = Document(other);
+        }
+
+        // Старое дерево освобождается раньше своей арены, а новое переезжает вместе со своей
+        Document& operator=(Document&& other) noexcept {
+            if (this != &other) {
+                root_ = nullptr;
+                arena_ = std::move(other.arena_);
+                root_ = std::move(other.root_);
+                owner_ = std::move(other.owner_);
+                buffer_ = other.buffer_;
+            }
+            return *this;
+        }
+
         const Node& GetRoot() const {
             return root_;
         }
 
+        // Пустая, если документ собран в куче
+        const std::shared_ptr<Arena>& GetArena() const {
+            return arena_;
+        }
+
+        // Пустые, если документ владеет всеми своими строками
+        const std::shared_ptr<const void>& GetOwner() const {
+            return owner_;
+        }
+        std::string_view GetBuffer() const {
+            return buffer_;
+        }
+
     private:
+        // Объявлена раньше дерева, чтобы пережить его
+        std::shared_ptr<Arena> arena_;
         Node root_;
+        std::shared_ptr<const void> owner_;
+        std::string_view buffer_;
     };
 
     inline bool operator==(const Document& lhs, const Document& rhs) {
@@ -136,8 +350,120 @@ namespace json {
         return !(lhs == rhs);
     }
 
+    // Читает поток целиком и разбирает его как Load(std::string_view)
     Document Load(std::istream& input);
 
-    void Print(const Document& doc, std::ostream& output);
+    // Массивы, словари и строки документа выделяются в его арене; ключи словарей
+    // остаются std::string и, будучи короткими, лежат в самих элементах
+    Document Load(std::string_view text);
+
+    // Как Load, но строки без escape-последовательностей не копируются, а ссылаются
+    // на text; owner удерживает text, пока жив документ
+    Document LoadBorrowed(std::shared_ptr<const void> owner, std::string_view text);
+
+    // Получает элементы документа по мере разбора. Строки и ключи действительны
+    // только во время вызова
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+
+        virtual void OnNull() = 0;
+        virtual void OnBool(bool value) = 0;
+        virtual void OnInt(int value) = 0;
+        virtual void OnDouble(double value) = 0;
+        virtual void OnString(std::string_view value) = 0;
+        virtual void OnStartArray() = 0;
+        virtual void OnEndArray() = 0;
+        virtual void OnStartDict() = 0;
+        virtual void OnKey(std::string_view key) = 0;
+        virtual void OnEndDict() = 0;
+    };
+
+    // Разбирает один документ, не собирая его в память; поток читается порциями.
+    // Грамматика та же, что у Load
+    void Parse(std::istream& input, Handler& handler);
+
+    void Parse(std::string_view text, Handler& handler);
+
+    // Собирает узел из событий разбора, например, чтобы материализовать часть документа
+    class NodeCollector final : public Handler {
+    public:
+        void OnNull() override;
+        void OnBool(bool value) override;
+        void OnInt(int value) override;
+        void OnDouble(double value) override;
+        void OnString(std::string_view value) override;
+        void OnStartArray() override;
+        void OnEndArray() override;
+        void OnStartDict() override;
+        void OnKey(std::string_view key) override;
+        void OnEndDict() override;
+
+        // Узел верхнего уровня собран целиком
+        bool IsComplete() const;
+
+        // Забирает собранный узел; после этого можно собирать следующий
+        Node Extract();
+
+    private:
+        struct Frame {
+            bool is_dict = false;
+            Array array;
+            Dict dict;
+            std::string key;
+        };
+
+        std::vector<Frame> stack_;
+        std::optional<Node> root_;
+
+        void Add(Node node);
+    };
+
+    enum class PrintStyle {
+        // Каждый элемент с новой строки, отступ 4 пробела на уровень
+        INDENTED,
+        // Без пробелов и переводов строк
+        COMPACT
+    };
+
+    struct PrintSettings {
+        // Значение precision, при котором дробные числа выводятся кратчайшей записью,
+        // читающейся обратно без потерь
+        static const int SHORTEST = 0;
+
+        PrintStyle style = PrintStyle::INDENTED;
+        // Значащих цифр у дробных чисел; по умолчанию столько же, сколько у std::ostream
+        int precision = 6;
+    };
+
+    void Print(const Document& doc, std::ostream& output, const PrintSettings& settings = {});
+
+    // Содержимое строки между кавычками в том виде, в каком его выводит Print
+    std::string Escape(std::string_view value);
+
+    // Выводит массив по одному элементу, не собирая его в памяти. Текст копится
+    // в буфере и уходит в поток порциями; Finish закрывает массив и сбрасывает остаток
+    class ArrayWriter {
+    public:
+        explicit ArrayWriter(std::ostream& output, const PrintSettings& settings = {});
+
+        void Add(const Node& node);
+
+        // Элемент, заранее напечатанный через PrintElement с теми же настройками
+        void AddPrinted(std::string_view element);
+
+        void Finish();
+
+        // Текст элемента в том виде, в каком его вывел бы Add; можно звать из любого потока
+        static std::string PrintElement(const Node& node, const PrintSettings& settings = {});
+
+    private:
+        std::ostream& output_;
+        PrintSettings settings_;
+        std::string buffer_;
+        bool first_ = true;
+
+        void StartElement();
+    };
 
 }  // namespace json
\ No newline at end of file
@@ -1,151 +1,98 @@
 #include "json_builder.h"
 
-
 namespace json {
     using namespace std::literals;
 
     DictItemContext Builder::StartDict()
     {
-        if (step_stack_.empty()) throw std::logic_error("Must start with builder"s);
-        if (root_) throw std::logic_error("Build finished"s);
-        ++dicts_open_;
-        keys_.resize(dicts_open_);
-        all_dicts_.resize(dicts_open_);
-        step_stack_.push_back(Step::DICT);
+        Node& node = AddNode(Node(Dict()));
+        open_.push_back(open_.empty() ? nullptr : &node);
         return DictItemContext(*this);
     }
 
-    Builder& Builder::EndDict()
-    {
-        if (step_stack_.back() == Step::DICT) {
-            if (dicts_open_ > 0) {
-                Dict dict;
-                for (auto& [key, val] : all_dicts_[dicts_open_ - 1]) {
-                    dict[key] = std::move(val);
-                }
-                step_stack_.pop_back();
-                --dicts_open_;
-                keys_.resize(dicts_open_);
-                all_dicts_.resize(dicts_open_);
-                Node node_dict(std::move(dict));
-                AddNode(std::move(node_dict));
-            }
-            else throw std::logic_error("No dicts open"s);
-        }
-        else throw std::logic_error("Cannot close dict"s);
-        return *this;
+    Builder&& Builder::EndDict()
+    {
+        if (open_.empty() || !Top().IsDict()) throw std::logic_error("Cannot close dict"s);
+        open_.pop_back();
+        return std::move(*this);
     }
 
     ArrayContext Builder::StartArray()
     {
-        if (step_stack_.empty()) throw std::logic_error("Must start with builder"s);
-        if (root_) throw std::logic_error("Build finished"s);
-        ++arrays_open_;
-        all_arrays_.resize(arrays_open_);
-        step_stack_.push_back(Step::ARR);
+        Node& node = AddNode(Node(Array()));
+        open_.push_back(open_.empty() ? nullptr : &node);
         return *this;
     }
 
-    Builder& Builder::EndArray()
-    {
-        if (step_stack_.back() == Step::ARR) {
-            if (arrays_open_ > 0) {
-                Array arr;
-                for (auto& elem : all_arrays_[arrays_open_ - 1]) {
-                    arr.push_back(std::move(elem));
-                }
-                step_stack_.pop_back();
-                --arrays_open_;
-                all_arrays_.resize(arrays_open_);
-                Node node_arr(std::move(arr));
-                AddNode(std::move(node_arr));
-            }
-            else throw std::logic_error("No arrays open"s);
-        }
-        else throw std::logic_error("Cannot close array"s);
-        return *this;
+    Builder&& Builder::EndArray()
+    {
+        if (open_.empty() || !Top().IsArray()) throw std::logic_error("Cannot close array"s);
+        open_.pop_back();
+        return std::move(*this);
     }
 
-    DictValueContext Builder::Key(const std::string& key)
+    DictValueContext Builder::Key(std::string key)
     {
-        if (step_stack_.back() == Step::DICT) {
-            if (dicts_open_ > 0) {
-                if (!keys_[dicts_open_ - 1]) {
-                    keys_[dicts_open_ - 1] = key;
-                }
-                else throw std::logic_error("Key already set"s);
-            }
-            else throw std::logic_error("No dicts open"s);
-        }
-        else throw std::logic_error("Must start a dict"s);
+        if (open_.empty() || !Top().IsDict()) throw std::logic_error("Must start a dict"s);
+        if (key_) throw std::logic_error("Key already set"s);
+        key_ = std::move(key);
         return *this;
     }
 
     Builder& Builder::Value(const Node::Value& val) {
-        if (step_stack_.empty()) throw std::logic_error("Must start with builder"s);
-        if (root_) throw std::logic_error("Build finished"s);
-        Node node;
-        if (std::holds_alternative<std::string>(val)) {
-            node = Node(std::get<std::string>(val));
-        }
-        else if (std::holds_alternative<int>(val)) {
-            node = Node(std::get<int>(val));
-        }
-        else if (std::holds_alternative<bool>(val)) {
-            node = Node(std::get<bool>(val));
-        }
-        else if (std::holds_alternative<double>(val)) {
-            node = Node(std::get<double>(val));
-        }
-        else if (std::holds_alternative<Array>(val)) {
-            node = Node(std::get<Array>(val));
-        }
-        else if (std::holds_alternative<Dict>(val)) {
-            node = Node(std::get<Dict>(val));
-        }
-        else {
-            node = Node(nullptr);
-        }
-        AddNode(std::move(node));
+        return Value(Node::Value(val));
+    }
+
+    Builder& Builder::Value(Node::Value&& val) {
+        AddNode(std::visit([](auto&& v) { return Node(std::move(v)); }, std::move(val)));
         return *this;
     }
 
-    void Builder::AddNode(Node&& node)
+    Node& Builder::AddNode(Node&& node)
     {
-        if (step_stack_.back() == Step::ARR) {
-            if (arrays_open_ > 0) {
-                all_arrays_[arrays_open_ - 1].push_back(std::move(node));
-            }
-            else throw std::logic_error("No arrays open"s);
-        }
-        else if (step_stack_.back() == Step::DICT) {
-            if (dicts_open_ > 0) {
-                if (keys_[dicts_open_ - 1]) {
-                    all_dicts_[dicts_open_ - 1].push_back({ keys_[dicts_open_ - 1].value(), std::move(node) });
-                    keys_[dicts_open_ - 1].reset();
-                }
-                else throw std::logic_error("No key"s);
-            }
-            else throw std::logic_error("No dicts open"s);
-        }
-        else {
+        if (open_.empty()) {
+            if (root_) throw std::logic_error("Build finished"s);
             root_ = std::move(node);
+            return *root_;
         }
+        Node& parent = Top();
+        if (parent.IsArray()) {
+            return std::get<Array>(parent.GetValue()).emplace_back(std::move(node));
+        }
+        if (!key_) throw std::logic_error("No key"s);
+        // Повторный ключ, как и раньше, заменяет значение
+        Node& item = std::get<Dict>(parent.GetValue()).try_emplace(std::move(*key_)).first->second;
+        key_.reset();
+        item = std::move(node);
+        return item;
     }
 
-    Node Builder::Build() const {
-        if (root_) {
-            return root_.value();
-        }
-        else throw std::logic_error("Must finish build"s);
+    Node Builder::Build() const& {
+        if (!IsComplete()) throw std::logic_error("Must finish build"s);
+        return *root_;
+    }
+
+    Node Builder::Build() && {
+        if (!IsComplete()) throw std::logic_error("Must finish build"s);
+        Node root = std::move(*root_);
+        root_.reset();
+        return root;
+    }
+
+    Node& Builder::Top() {
+        return open_.back() ? *open_.back() : *root_;
     }
 
-    DictValueContext DictItemContext::Key(const std::string& key)
+    bool Builder::IsComplete() const {
+        return root_ && open_.empty();
+    }
+
+    DictValueContext DictItemContext::Key(std::string key)
     {
-        return builder_.Key(key);
+        return builder_.Key(std::move(key));
     }
 
-    Builder& DictItemContext::EndDict()
+    Builder&& DictItemContext::EndDict()
     {
         return builder_.EndDict();
     }
@@ -155,6 +102,11 @@ namespace json {
         return builder_.Value(val);
     }
 
+    DictItemContext DictValueContext::Value(Node::Value&& val)
+    {
+        return builder_.Value(std::move(val));
+    }
+
     DictItemContext DictValueContext::StartDict()
     {
         return builder_.StartDict();
@@ -170,6 +122,11 @@ namespace json {
         return builder_.Value(val);
     }
 
+    ArrayContext ArrayContext::Value(Node::Value&& val)
+    {
+        return builder_.Value(std::move(val));
+    }
+
     DictItemContext ArrayContext::StartDict()
     {
         return builder_.StartDict();
@@ -180,7 +137,7 @@ namespace json {
         return builder_.StartArray();
     }
 
-    Builder& ArrayContext::EndArray()
+    Builder&& ArrayContext::EndArray()
     {
         return builder_.EndArray();
     }
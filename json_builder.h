@@ -9,39 +9,43 @@
 
 namespace json {
 
-    enum class Step {
-        BUILD,
-        ARR,
-        DICT
-    };
-
     class DictItemContext;
     class DictValueContext;
     class ArrayContext;
 
+    // Узлы собираются сразу на своих местах внутри родителя; значения, переданные
+    // по rvalue-ссылке, перемещаются. EndDict и EndArray возвращают построитель как rvalue,
+    // поэтому Build в конце цепочки забирает результат без копирования
     class Builder {
     public:
-        Builder() {
-            step_stack_.push_back(Step::BUILD);
-        }
+        Builder() = default;
+
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+        Builder(Builder&&) = default;
+        Builder& operator=(Builder&&) = default;
 
         DictItemContext StartDict();
-        Builder& EndDict();
+        Builder&& EndDict();
         ArrayContext StartArray();
-        Builder& EndArray();
-        DictValueContext Key(const std::string& key);
+        Builder&& EndArray();
+        DictValueContext Key(std::string key);
         Builder& Value(const Node::Value& val);
-        Node Build() const;
-        void AddNode(Node&& node);
+        Builder& Value(Node::Value&& val);
+        Node Build() const&;
+        Node Build() &&;
+        // Возвращает добавленный узел на его месте в родителе
+        Node& AddNode(Node&& node);
 
     private:
         std::optional<Node> root_;
-        std::vector<Step> step_stack_;
-        std::vector< std::optional<std::string> > keys_;
-        int dicts_open_ = 0;
-        int arrays_open_ = 0;
-        std::vector<std::vector<Node>> all_arrays_;
-        std::vector< std::vector<std::pair<std::string, Node>> > all_dicts_;
+        // Открытые массивы и словари от внешнего к внутреннему. Корень обозначен nullptr,
+        // чтобы указатели оставались верными при перемещении построителя
+        std::vector<Node*> open_;
+        std::optional<std::string> key_;
+
+        Node& Top();
+        bool IsComplete() const;
     };
 
     class DictItemContext {
@@ -49,8 +53,8 @@ namespace json {
         DictItemContext(Builder& builder)
             : builder_(builder) {}
 
-        DictValueContext Key(const std::string& key);
-        Builder& EndDict();
+        DictValueContext Key(std::string key);
+        Builder&& EndDict();
 
     private:
         Builder& builder_;
@@ -62,6 +66,7 @@ namespace json {
             : builder_(builder) {}
 
         DictItemContext Value(const Node::Value& val);
+        DictItemContext Value(Node::Value&& val);
         DictItemContext StartDict();
         ArrayContext StartArray();
 
@@ -75,9 +80,10 @@ namespace json {
             : builder_(builder) {}
 
         ArrayContext Value(const Node::Value& val);
+        ArrayContext Value(Node::Value&& val);
         DictItemContext StartDict();
         ArrayContext StartArray();
-        Builder& EndArray();
+        Builder&& EndArray();
 
     private:
         Builder& builder_;
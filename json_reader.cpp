@@ -1,7 +1,129 @@
 #include "json_reader.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 using namespace std;
 
+namespace {
+
+    // Собирает документ без base_requests: каждый запрос из base_requests передаётся
+    // в on_request, как только разобран, и сразу освобождается
+    template <typename OnRequest>
+    class BaseRequestsHandler final : public json::Handler {
+    public:
+        explicit BaseRequestsHandler(OnRequest on_request)
+            : on_request_(move(on_request)) {}
+
+        void OnNull() override {
+            Target().OnNull();
+            AfterValue();
+        }
+        void OnBool(bool value) override {
+            Target().OnBool(value);
+            AfterValue();
+        }
+        void OnInt(int value) override {
+            Target().OnInt(value);
+            AfterValue();
+        }
+        void OnDouble(double value) override {
+            Target().OnDouble(value);
+            AfterValue();
+        }
+        void OnString(string_view value) override {
+            Target().OnString(value);
+            AfterValue();
+        }
+        void OnStartArray() override {
+            if (base_pending_) {
+                base_pending_ = false;
+                in_base_ = true;
+            }
+            else {
+                Target().OnStartArray();
+            }
+            ++depth_;
+        }
+        void OnEndArray() override {
+            --depth_;
+            if (in_base_ && depth_ == 1) {
+                in_base_ = false;
+                return;
+            }
+            Target().OnEndArray();
+            AfterValue();
+        }
+        void OnStartDict() override {
+            Target().OnStartDict();
+            ++depth_;
+        }
+        void OnKey(string_view key) override {
+            if (depth_ == 1 && key == "base_requests"sv) {
+                base_pending_ = true;
+                return;
+            }
+            Target().OnKey(key);
+        }
+        void OnEndDict() override {
+            --depth_;
+            Target().OnEndDict();
+            AfterValue();
+        }
+
+        json::Document GetDocument() {
+            return json::Document(document_.Extract());
+        }
+
+    private:
+        OnRequest on_request_;
+        json::NodeCollector document_;
+        json::NodeCollector request_;
+        int depth_ = 0;
+        bool base_pending_ = false;
+        bool in_base_ = false;
+
+        json::Handler& Target() {
+            if (base_pending_) {
+                throw json::ParsingError("base_requests must be an array"s);
+            }
+            return in_base_ ? request_ : document_;
+        }
+
+        void AfterValue() {
+            if (in_base_ && request_.IsComplete()) {
+                on_request_(request_.Extract());
+            }
+        }
+    };
+
+    template <typename Input, typename OnRequest>
+    json::Document ParseBaseRequestsStreaming(Input& input, OnRequest on_request) {
+        BaseRequestsHandler handler(move(on_request));
+        json::Parse(input, handler);
+        return handler.GetDocument();
+    }
+
+}
+
+JsonReader JsonReader::LoadStreaming(istream& input, tc::Catalogue& catalogue) {
+    CatalogueFiller filler(catalogue);
+    json::Document document = ParseBaseRequestsStreaming(input, [&filler](const json::Node& request_node) {
+        filler.Add(request_node);
+        });
+    filler.Finish();
+    return JsonReader(move(document));
+}
+
+JsonReader JsonReader::LoadStreaming(string_view text, tc::Catalogue& catalogue) {
+    CatalogueFiller filler(catalogue);
+    json::Document document = ParseBaseRequestsStreaming(text, [&filler](const json::Node& request_node) {
+        filler.Add(request_node);
+        });
+    filler.Finish();
+    return JsonReader(move(document));
+}
+
 const json::Node& JsonReader::GetBaseRequest() const
 {
     if (input_.GetRoot().AsDict().count("base_requests"s))
@@ -36,52 +158,173 @@ const json::Node& JsonReader::GetSerializationSettings() const {
     else return dumm_;
 }
 
+const json::Node& JsonReader::GetDeltaRequest() const {
+    if (input_.GetRoot().AsDict().count("delta_requests"s))
+        return input_.GetRoot().AsDict().at("delta_requests"s);
+    else return dumm_;
+}
+
 void JsonReader::FillCatalogue(tc::Catalogue& catalogue) const
 {
-    const json::Array& arr = GetBaseRequest().AsArray();
+    AdoptInputNames(catalogue);
+    CatalogueFiller filler(catalogue);
+    for (const auto& request_node : GetBaseRequest().AsArray()) {
+        filler.Add(request_node);
+    }
+    filler.Finish();
+}
+
+string_view JsonReader::NameStore::Intern(string_view name)
+{
+    if (const auto it = names_.find(name); it != names_.end()) {
+        return *it;
+    }
+    return *names_.insert(arena_.Store(name)).first;
+}
+
+void JsonReader::CatalogueFiller::Add(const json::Node& request_node)
+{
+    const json::Dict& request_map = request_node.AsDict();
+    const string_view type = request_map.at("type"s).AsString();
+    if (type == "Stop"s) {
+        ParseStopAddRequest(catalogue_, request_map, stop_to_stops_distance_, names_);
+    }
+    if (type == "Bus"s) {
+        ParseBusAddRequest(request_map, buses_info_, names_);
+    }
+}
+
+void JsonReader::CatalogueFiller::Finish()
+{
+    SetStopsDistances(catalogue_, stop_to_stops_distance_);
+    BusesAddProcess(catalogue_, buses_info_);
+    SetFinals(catalogue_, buses_info_);
+}
+
+tc::CatalogueChanges JsonReader::ApplyDelta(tc::Catalogue& catalogue) const
+{
+    AdoptInputNames(catalogue);
+    tc::CatalogueChanges changes;
     StopsDistMap stop_to_stops_distance;
     BusesInfoMap buses_info;
-    for (const auto& request_node : arr) {
+    vector<string_view> removed_stops;
+    vector<string_view> removed_buses;
+    // Новые остановки добавляются разом после разбора: каждое добавление сбрасывает индекс имён,
+    // и поиск между добавлениями перестраивал бы его для всего каталога
+    vector<pair<string_view, geo::Coordinates>> new_stops;
+    unordered_map<string_view, size_t> new_stop_positions;
+    NameStore names;
+    for (const auto& request_node : GetDeltaRequest().AsArray()) {
         const json::Dict& request_map = request_node.AsDict();
-        const string& type = request_map.at("type"s).AsString();
+        const string_view type = request_map.at("type"s).AsString();
+        const string_view name = request_map.at("name"s).AsString();
         if (type == "Stop"s) {
-            ParseStopAddRequest(catalogue, request_map, stop_to_stops_distance);
+            const geo::Coordinates coordinates{ request_map.at("latitude"s).AsDouble(),
+                                                request_map.at("longitude"s).AsDouble() };
+            const json::Dict& road_distances = request_map.at("road_distances"s).AsDict();
+            if (const domain::Stop* stop = catalogue.FindStop(name)) {
+                catalogue.SetStopCoordinates(stop, coordinates);
+                // Веса рёбер зависят только от расстояний, поэтому новые координаты граф не трогают
+                const bool distances_changed = any_of(road_distances.begin(), road_distances.end(),
+                    [stop](const auto& item) {
+                        const auto it = stop->stop_distances.find(item.first);
+                        return it == stop->stop_distances.end() || it->second != item.second.AsInt();
+                    });
+                if (distances_changed) {
+                    for (const auto& [bus_name, bus] : catalogue.GetBusesOnStop(name)) {
+                        changes.changed_buses.emplace(bus_name);
+                    }
+                }
+            }
+            else if (const auto [it, inserted] = new_stop_positions.emplace(name, new_stops.size()); inserted) {
+                new_stops.emplace_back(name, coordinates);
+                changes.added_stops.emplace(name);
+            }
+            else {
+                new_stops[it->second].second = coordinates;
+            }
+            for (const auto& [key_stop_name, dist_node] : road_distances) {
+                stop_to_stops_distance[name][key_stop_name] = dist_node.AsInt();
+            }
         }
         if (type == "Bus"s) {
-            ParseBusAddRequest(request_map, buses_info);
+            ParseBusAddRequest(request_map, buses_info, names);
+            changes.changed_buses.emplace(name);
+        }
+        if (type == "RemoveStop"s) {
+            removed_stops.push_back(name);
+        }
+        if (type == "RemoveBus"s) {
+            removed_buses.push_back(name);
+            changes.changed_buses.emplace(name);
         }
     }
+    for (const auto& [name, coordinates] : new_stops) {
+        catalogue.AddStop(name, coordinates);
+    }
     SetStopsDistances(catalogue, stop_to_stops_distance);
-    BusesAddProcess(catalogue, buses_info);
+    for (const string_view name : removed_buses) {
+        if (const domain::Bus* bus = catalogue.FindBus(name)) {
+            catalogue.RemoveBus(bus);
+        }
+    }
+    for (const auto& [name, info] : buses_info) {
+        const vector<tc::Stop*> stop_ptrs = FindBusStops(catalogue, name, info);
+        if (const domain::Bus* bus = catalogue.FindBus(name)) {
+            catalogue.SetBusStops(bus, stop_ptrs, info.is_circle);
+        }
+        else {
+            catalogue.AddBus(name, stop_ptrs, info.is_circle);
+        }
+    }
     SetFinals(catalogue, buses_info);
+    for (const string_view name : removed_stops) {
+        if (const domain::Stop* stop = catalogue.FindStop(name)) {
+            catalogue.RemoveStop(stop);
+            changes.removed_stops.emplace(name);
+        }
+    }
+    return changes;
+}
+
+void JsonReader::AdoptInputNames(tc::Catalogue& catalogue) const
+{
+    if (input_.GetOwner()) {
+        catalogue.AdoptNames(input_.GetOwner(), input_.GetBuffer());
+    }
 }
 
 void JsonReader::ParseStopAddRequest(tc::Catalogue& catalogue, const json::Dict& request_map,
-    StopsDistMap& stop_to_stops_distance) const
+    StopsDistMap& stop_to_stops_distance, NameStore& names)
 {
-    const string& stop_name = request_map.at("name"s).AsString();
+    const string_view stop_name = names.Intern(request_map.at("name"s).AsString());
     catalogue.AddStop(stop_name, {
                     request_map.at("latitude"s).AsDouble(),
                     request_map.at("longitude"s).AsDouble() });
     const json::Dict& near_stops = request_map.at("road_distances"s).AsDict();
     for (const auto& [key_stop_name, dist_node] : near_stops) {
-        stop_to_stops_distance[stop_name][key_stop_name] = dist_node.AsInt();
+        stop_to_stops_distance[stop_name][names.Intern(key_stop_name)] = dist_node.AsInt();
     }
 }
 
 void JsonReader::SetStopsDistances(tc::Catalogue& catalogue,
-    const StopsDistMap& stop_to_stops_distance) const
+    const StopsDistMap& stop_to_stops_distance)
 {
     for (const auto& [stop, near_stops] : stop_to_stops_distance) {
         for (const auto& [stop_name, dist] : near_stops) {
-            catalogue.SetDistance(catalogue.FindStop(stop), catalogue.FindStop(stop_name), dist);
+            tc::Stop* from = catalogue.FindStop(stop);
+            tc::Stop* to = catalogue.FindStop(stop_name);
+            if (!from || !to) {
+                throw invalid_argument("Unknown stop in road_distances: "s + string(from ? stop_name : stop));
+            }
+            catalogue.SetDistance(from, to, dist);
         }
     }
 }
 
-void JsonReader::ParseBusAddRequest(const json::Dict& request_map, BusesInfoMap& buses_info) const
+void JsonReader::ParseBusAddRequest(const json::Dict& request_map, BusesInfoMap& buses_info, NameStore& names)
 {
-    const string& bus_name = request_map.at("name"s).AsString();
+    const string_view bus_name = names.Intern(request_map.at("name"s).AsString());
     const json::Array& bus_stops = request_map.at("stops"s).AsArray();
     size_t stops_count = bus_stops.size();
     bool is_roundtrip = request_map.at("is_roundtrip"s).AsBool();
@@ -89,40 +332,48 @@ void JsonReader::ParseBusAddRequest(const json::Dict& request_map, BusesInfoMap&
     auto& stops = buses_info[bus_name].stops;
     if (stops_count > 0) stops.reserve(is_roundtrip ? stops_count : stops_count * 2);
     for (size_t i = 0; i < bus_stops.size(); ++i) {
-        stops.push_back(bus_stops[i].AsString());
+        stops.push_back(names.Intern(bus_stops[i].AsString()));
         if (i == bus_stops.size() - 1) {
             if (!is_roundtrip) {
-                buses_info[bus_name].final_stop = bus_stops[i].AsString();
+                buses_info[bus_name].final_stop = stops.back();
                 for (int j = stops.size() - 2; j >= 0; --j) {
                     stops.push_back(stops[j]);
                 }
             }
             else {
-                buses_info[bus_name].final_stop = bus_stops[0].AsString();
+                buses_info[bus_name].final_stop = names.Intern(bus_stops[0].AsString());
             }
         }
     }
 }
 
-void JsonReader::BusesAddProcess(tc::Catalogue& catalogue, const BusesInfoMap& buses_info) const
+vector<tc::Stop*> JsonReader::FindBusStops(tc::Catalogue& catalogue, string_view bus_name, const Bus_info& info)
 {
-    for (const auto& [name, info] : buses_info) {
-        vector<tc::Stop*> stop_ptrs;
-        const auto& stops = info.stops;
-        stop_ptrs.reserve(stops.size());
-        for (const auto& stop : stops) {
-            stop_ptrs.push_back(catalogue.FindStop(stop));
+    vector<tc::Stop*> stop_ptrs;
+    stop_ptrs.reserve(info.stops.size());
+    for (const auto& stop : info.stops) {
+        tc::Stop* stop_ptr = catalogue.FindStop(stop);
+        if (!stop_ptr) {
+            throw invalid_argument("Unknown stop "s + string(stop) + " on bus "s + string(bus_name));
         }
-        catalogue.AddBus(static_cast<string>(name), stop_ptrs, info.is_circle);
+        stop_ptrs.push_back(stop_ptr);
+    }
+    return stop_ptrs;
+}
+
+void JsonReader::BusesAddProcess(tc::Catalogue& catalogue, const BusesInfoMap& buses_info)
+{
+    for (const auto& [name, info] : buses_info) {
+        catalogue.AddBus(static_cast<string>(name), FindBusStops(catalogue, name, info), info.is_circle);
     }
 }
 
-void JsonReader::SetFinals(tc::Catalogue& catalogue, const BusesInfoMap& buses_info) const
+void JsonReader::SetFinals(tc::Catalogue& catalogue, const BusesInfoMap& buses_info)
 {
     for (auto& [bus_name, info] : buses_info) {
-        if (domain::Bus* bus = catalogue.FindBus(bus_name)) {
-            if (domain::Stop* stop = catalogue.FindStop(info.final_stop)) {
-                bus->final_stop = stop;
+        if (const domain::Bus* bus = catalogue.FindBus(bus_name)) {
+            if (const domain::Stop* stop = catalogue.FindStop(info.final_stop)) {
+                catalogue.SetFinalStop(bus, stop);
             }
         }
     }
@@ -3,8 +3,12 @@
 #include "json.h"
 #include "transport_catalogue.h"
 #include "domain.h"
+#include "string_arena.h"
 
+#include <iostream>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -12,7 +16,13 @@
 class JsonReader {
 public:
     JsonReader(json::Document input_json)
-        : input_(input_json) {}
+        : input_(std::move(input_json)) {}
+
+    // Читает запросы потоком: каждый запрос из base_requests заносится в catalogue сразу
+    // после разбора и освобождается, в документе остаются только прочие разделы
+    static JsonReader LoadStreaming(std::istream& input, tc::Catalogue& catalogue);
+
+    static JsonReader LoadStreaming(std::string_view text, tc::Catalogue& catalogue);
 
     const json::Node& GetBaseRequest() const;
 
@@ -24,8 +34,14 @@ public:
 
     const json::Node& GetSerializationSettings() const;
 
+    const json::Node& GetDeltaRequest() const;
+
     void FillCatalogue(tc::Catalogue& catalogue) const;
 
+    // Применяет delta_requests к уже заполненному каталогу:
+    // Stop и Bus добавляют или заменяют объект, RemoveStop и RemoveBus удаляют его
+    tc::CatalogueChanges ApplyDelta(tc::Catalogue& catalogue) const;
+
 private:
     json::Document input_;
     json::Node dumm_{ nullptr };
@@ -39,12 +55,44 @@ private:
     using StopsDistMap = std::unordered_map<std::string_view, std::unordered_map<std::string_view, int>>;
     using BusesInfoMap = std::unordered_map<std::string_view, Bus_info>;
 
-    void ParseStopAddRequest(tc::Catalogue& catalogue, const json::Dict& request_map,
-        StopsDistMap& stop_to_stops_distance) const;
-    void SetStopsDistances(tc::Catalogue& catalogue,
-        const StopsDistMap& stop_to_stops_distance) const;
-    void ParseBusAddRequest(const json::Dict& request_map, BusesInfoMap& buses_info) const;
-    void BusesAddProcess(tc::Catalogue& catalogue, const BusesInfoMap& buses_info) const;
-    void SetFinals(tc::Catalogue& catalogue, const BusesInfoMap& buses_info) const;
+    // Копии имён из запросов: ссылки на остановки разрешаются, когда все запросы
+    // уже прочитаны, а сами запросы к этому времени могут быть освобождены
+    class NameStore {
+    public:
+        std::string_view Intern(std::string_view name);
+
+    private:
+        tc::StringArena arena_;
+        std::unordered_set<std::string_view> names_;
+    };
+
+    // Принимает запросы base_requests по одному и в конце связывает их в каталоге
+    class CatalogueFiller {
+    public:
+        explicit CatalogueFiller(tc::Catalogue& catalogue)
+            : catalogue_(catalogue) {}
+
+        void Add(const json::Node& request_node);
+        void Finish();
+
+    private:
+        tc::Catalogue& catalogue_;
+        StopsDistMap stop_to_stops_distance_;
+        BusesInfoMap buses_info_;
+        NameStore names_;
+    };
+
+    // Имена, лежащие в буфере документа, каталог не копирует, а удерживает сам буфер
+    void AdoptInputNames(tc::Catalogue& catalogue) const;
+    static void ParseStopAddRequest(tc::Catalogue& catalogue, const json::Dict& request_map,
+        StopsDistMap& stop_to_stops_distance, NameStore& names);
+    // Бросает std::invalid_argument, если какой-то из остановок нет в каталоге
+    static void SetStopsDistances(tc::Catalogue& catalogue,
+        const StopsDistMap& stop_to_stops_distance);
+    static void ParseBusAddRequest(const json::Dict& request_map, BusesInfoMap& buses_info, NameStore& names);
+    // Бросает std::invalid_argument, если какой-то остановки маршрута нет в каталоге
+    static std::vector<tc::Stop*> FindBusStops(tc::Catalogue& catalogue, std::string_view bus_name, const Bus_info& info);
+    static void BusesAddProcess(tc::Catalogue& catalogue, const BusesInfoMap& buses_info);
+    static void SetFinals(tc::Catalogue& catalogue, const BusesInfoMap& buses_info);
 
 };
\ No newline at end of file
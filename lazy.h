@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Значение, которое создаётся при первом обращении. Одновременные первые
+// обращения из разных потоков дожидаются одной и той же загрузки.
+template <typename T>
+class Lazy {
+public:
+    using Loader = std::function<std::unique_ptr<T>()>;
+
+    explicit Lazy(Loader loader)
+        : state_(std::make_shared<State>()) {
+        state_->loader = std::move(loader);
+    }
+
+    // Уже готовое значение
+    explicit Lazy(std::unique_ptr<T> value)
+        : state_(std::make_shared<State>()) {
+        state_->value = std::move(value);
+        std::call_once(state_->flag, [] {});
+    }
+
+    const T& Get() const {
+        std::call_once(state_->flag, [this] {
+            state_->value = state_->loader();
+            state_->loader = nullptr;
+            });
+        return *state_->value;
+    }
+
+private:
+    struct State {
+        std::once_flag flag;
+        Loader loader;
+        std::unique_ptr<T> value;
+    };
+
+    std::shared_ptr<State> state_;
+};
@@ -6,48 +6,175 @@
 #include "map_renderer.h"
 #include "transport_router.h"
 #include "serialization.h"
+#include "mapped_file.h"
+#include "stat_protocol.h"
 
 #include <transport_catalogue.pb.h>
 
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <utility>
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|apply_delta] [--input file] [--compact] [--precision digits|shortest]"
+        " [--protocol json|protobuf] [--parallel]\n"sv;
+}
+
+// Формат запросов и ответов process_requests
+enum class Protocol {
+    JSON,
+    // См. stat_protocol.proto
+    PROTOBUF
+};
+
+// Необязательные ключи после режима
+struct Options {
+    std::optional<std::string> input_file;
+    json::PrintSettings output;
+    Protocol protocol = Protocol::JSON;
+    Execution execution = Execution::SEQUENTIAL;
+};
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg == "--input"sv && i + 1 < argc) {
+            options.input_file = argv[++i];
+        }
+        else if (arg == "--compact"sv) {
+            options.output.style = json::PrintStyle::COMPACT;
+        }
+        else if (arg == "--precision"sv && i + 1 < argc) {
+            const std::string_view value(argv[++i]);
+            int precision = 0;
+            if (value == "shortest"sv) {
+                precision = json::PrintSettings::SHORTEST;
+            }
+            else if (const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), precision);
+                ec != std::errc{} || ptr != value.data() + value.size() || precision <= 0 || precision > 17) {
+                return std::nullopt;
+            }
+            options.output.precision = precision;
+        }
+        else if (arg == "--protocol"sv && i + 1 < argc) {
+            const std::string_view value(argv[++i]);
+            if (value == "json"sv) {
+                options.protocol = Protocol::JSON;
+            }
+            else if (value == "protobuf"sv) {
+                options.protocol = Protocol::PROTOBUF;
+            }
+            else {
+                return std::nullopt;
+            }
+        }
+        else if (arg == "--parallel"sv) {
+            options.execution = Execution::PARALLEL;
+        }
+        else {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+// Файл запросов отображается в память, и строки документа ссылаются прямо на него
+json::Document LoadInput(const std::optional<std::string>& input_file) {
+    if (!input_file) {
+        return json::Load(std::cin);
+    }
+    auto file = std::make_shared<const MappedFile>(*input_file);
+    const std::string_view text = file->GetData();
+    return json::LoadBorrowed(std::move(file), text);
+}
+
+protocol::RequestBatch LoadBinaryInput(const std::optional<std::string>& input_file) {
+    if (!input_file) {
+        return protocol::ReadRequests(std::cin);
+    }
+    return protocol::ReadRequests(MappedFile(*input_file).GetData());
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    const std::optional<Options> options = argc >= 2 ? ParseOptions(argc, argv) : std::nullopt;
+    if (!options) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
+    const std::optional<std::string>& input_file = options->input_file;
 
     if (mode == "make_base"sv) {
-        JsonReader input_json(json::Load(std::cin));
+        // base_requests разбираются потоком и в документ не попадают
         tc::Catalogue tcat;
-        input_json.FillCatalogue(tcat);
+        JsonReader input_json = input_file
+            ? JsonReader::LoadStreaming(MappedFile(*input_file).GetData(), tcat)
+            : JsonReader::LoadStreaming(std::cin, tcat);
         renderer::MapRenderer renderer(input_json.GetRenderSettings());
         tc::Router router(input_json.GetRoutingSettings(), tcat);
-        std::ofstream fout(input_json.GetSerializationSettings().AsDict().at("file"s).AsString(), std::ios::binary);
-        if (fout.is_open()) {
-            Serialize(tcat, renderer, router, fout);
+        const json::Node& settings = input_json.GetSerializationSettings();
+        SaveBase(std::string(settings.AsDict().at("file"s).AsString()), GetBaseFormat(settings), tcat, renderer, router,
+            GetPrerenderMap(settings));
+    }
+    else if (mode == "process_requests"sv && options->protocol == Protocol::PROTOBUF) {
+        const protocol::RequestBatch batch = LoadBinaryInput(input_file);
+        if (auto base = OpenBase(batch.file())) {
+            tc::CatalogueHolder catalogues(std::move(base->catalogue));
+            RequestHandler handler(catalogues, base->router, base->renderer, base->map, options->execution);
+            handler.BinaryStatRequests(batch, std::cout);
         }
     }
     else if (mode == "process_requests"sv) {
-        JsonReader input_json(json::Load(std::cin));
-        std::ifstream db_file(input_json.GetSerializationSettings().AsDict().at("file"s).AsString(), std::ios::binary);
-        if (db_file) {
-            auto [tcat, renderer, router, graph, stop_ids] = Deserialize(db_file);
-            router.SetGraph(std::move(graph), std::move(stop_ids));
-            RequestHandler handler(tcat, router, renderer);
-            handler.JsonStatRequests(input_json.GetStatRequest(), std::cout);
+        JsonReader input_json(LoadInput(input_file));
+        if (auto base = OpenBase(std::string(input_json.GetSerializationSettings().AsDict().at("file"s).AsString()))) {
+            tc::CatalogueHolder catalogues(std::move(base->catalogue));
+            RequestHandler handler(catalogues, base->router, base->renderer, base->map, options->execution);
+            handler.JsonStatRequests(input_json.GetStatRequest(), std::cout, options->output);
+        }
+    }
+    else if (mode == "apply_delta"sv) {
+        JsonReader input_json(LoadInput(input_file));
+        const std::string file(input_json.GetSerializationSettings().AsDict().at("file"s).AsString());
+        const std::optional<BaseFormat> format = DetectBaseFormat(file);
+        auto base = format ? LoadBase(file) : std::nullopt;
+        if (!base) {
+            std::cerr << "Cannot load base "s << file << '\n';
+            return 1;
+        }
+        auto& [tcat, renderer, router, graph, stop_ids, map] = *base;
+        tc::CatalogueChanges changes;
+        try {
+            changes = input_json.ApplyDelta(tcat);
+        }
+        catch (const std::logic_error& e) {
+            // Дельта со ссылками на неизвестные остановки отклоняется, база на диске не меняется
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+        router.UpdateGraph(tcat, std::move(graph), std::move(stop_ids), changes);
+        // Пишем во временный файл, чтобы читатели старой базы не увидели её наполовину записанной;
+        // уже отображённый в память старый файл остаётся у них целым
+        const std::string tmp_file = file + ".tmp"s;
+        // Сохранённая карта устарела вместе с каталогом и рисуется заново
+        SaveBase(tmp_file, *format, tcat, renderer, router, map.has_value());
+        if (std::rename(tmp_file.c_str(), file.c_str()) != 0) {
+            std::cerr << "Cannot replace base "s << file << ": "s << std::strerror(errno) << '\n';
+            std::remove(tmp_file.c_str());
+            return 1;
         }
     }
     else {
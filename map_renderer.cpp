@@ -1,5 +1,7 @@
 #include "map_renderer.h"
 
+#include <sstream>
+#include <utility>
 #include <vector>
 
 namespace renderer {
@@ -36,7 +38,7 @@ namespace renderer {
             else throw std::logic_error("Strange array"s);
         }
         else if (settings_map.at("underlayer_color"s).IsString()) {
-            underlayer_color_ = settings_map.at("underlayer_color"s).AsString();
+            underlayer_color_ = std::string(settings_map.at("underlayer_color"s).AsString());
         }
         else throw std::logic_error("Error color identity"s);
         underlayer_width_ = settings_map.at("underlayer_width"s).AsDouble();
@@ -55,17 +57,17 @@ namespace renderer {
                 else throw std::logic_error("Strange array"s);
             }
             else if (node.IsString()) {
-                color_palette_.push_back(node.AsString());
+                color_palette_.emplace_back(std::string(node.AsString()));
             }
             else throw std::logic_error("Error palette color identity"s);
         }
     }
 
-    std::vector<svg::Polyline> MapRenderer::GetBusLines(const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& sp) const
+    std::vector<svg::Polyline> MapRenderer::GetBusLines(const std::vector<domain::Bus*>& buses, const SphereProjector& sp) const
     {
         std::vector<svg::Polyline> result;
         unsigned color_num = 0;
-        for (auto& [bus_name, bus_ptr] : buses) {
+        for (const domain::Bus* bus_ptr : buses) {
             if (bus_ptr->stops.size() == 0) continue;
             svg::Polyline line;
             std::vector<geo::Coordinates> points;
@@ -86,16 +88,16 @@ namespace renderer {
         return result;
     }
 
-    std::vector<svg::Text> MapRenderer::GetBusLabels(const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& sp) const
+    std::vector<svg::Text> MapRenderer::GetBusLabels(const std::vector<domain::Bus*>& buses, const SphereProjector& sp) const
     {
         std::vector<svg::Text> result;
         unsigned color_num = 0;
-        for (auto& [bus_name, bus_ptr] : buses) {
+        for (const domain::Bus* bus_ptr : buses) {
             if (bus_ptr->stops.size() == 0) continue;
             svg::Text text_underlayer;
             svg::Text text;
-            text_underlayer.SetData(bus_ptr->name);
-            text.SetData(bus_ptr->name);
+            text_underlayer.SetData(std::string(bus_ptr->name));
+            text.SetData(std::string(bus_ptr->name));
             text.SetFillColor(color_palette_[color_num]);
             if (color_num < (color_palette_.size() - 1)) {
                 ++color_num;
@@ -139,13 +141,13 @@ namespace renderer {
             text.SetOffset(stop_label_offset_);
             text.SetFontSize(stop_label_font_size_);
             text.SetFontFamily("Verdana"s);
-            text.SetData(stop_ptr->name);
+            text.SetData(std::string(stop_ptr->name));
             text.SetFillColor("black"s);
             text_underlayer.SetPosition(sp(stop_ptr->coordinates));
             text_underlayer.SetOffset(stop_label_offset_);
             text_underlayer.SetFontSize(stop_label_font_size_);
             text_underlayer.SetFontFamily("Verdana"s);
-            text_underlayer.SetData(stop_ptr->name);
+            text_underlayer.SetData(std::string(stop_ptr->name));
             text_underlayer.SetFillColor(underlayer_color_);
             text_underlayer.SetStrokeColor(underlayer_color_);
             text_underlayer.SetStrokeWidth(underlayer_width_);
@@ -170,12 +172,12 @@ namespace renderer {
         return result;
     }
 
-    svg::Document MapRenderer::GetSvgDocument(const std::map<std::string_view, domain::Bus*>& buses) const
+    svg::Document MapRenderer::GetSvgDocument(const std::vector<domain::Bus*>& buses) const
     {
         std::map<std::string_view, domain::Stop*> all_stops;
         std::vector<geo::Coordinates> all_coords;
         svg::Document result;
-        for (const auto& [bus_name, bus_ptr] : buses) {
+        for (const domain::Bus* bus_ptr : buses) {
             if (bus_ptr->stops.size() == 0) continue;
             for (const auto& stop : bus_ptr->stops) {
                 all_stops[stop->name] = stop;
@@ -227,6 +229,21 @@ namespace renderer {
         return json::Node(std::move(result));
     }
 
+    MapText MakeMapText(std::string svg, std::string escaped)
+    {
+        auto text = std::make_shared<std::pair<std::string, std::string>>(std::move(svg), std::move(escaped));
+        return { text, text->first, text->second };
+    }
+
+    MapText MapRenderer::RenderText(const std::vector<domain::Bus*>& buses) const
+    {
+        std::ostringstream strm;
+        GetSvgDocument(buses).Render(strm);
+        std::string svg = strm.str();
+        std::string escaped = json::Escape(svg);
+        return MakeMapText(std::move(svg), std::move(escaped));
+    }
+
     json::Node MapRenderer::GetRenderSettings() const {
         return json::Node(json::Dict{
                     {{"width"s},{width_}},
@@ -12,26 +12,41 @@
 #include <algorithm>
 #include <map>
 #include <optional>
+#include <memory>
 
 namespace renderer {
 
     class SphereProjector;
 
+    // Готовый текст карты. Строки принадлежат owner, например отображённому в память файлу базы
+    struct MapText {
+        std::shared_ptr<const void> owner;
+        std::string_view svg;
+        // svg, экранированная для вывода строкой JSON
+        std::string_view escaped;
+    };
+
+    // Текст, который хранит сам себя
+    MapText MakeMapText(std::string svg, std::string escaped);
+
     class MapRenderer {
     public:
         MapRenderer() = default;
 
         MapRenderer(const json::Node& render_settings);
 
-        std::vector<svg::Polyline> GetBusLines(const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& sp) const;
+        std::vector<svg::Polyline> GetBusLines(const std::vector<domain::Bus*>& buses, const SphereProjector& sp) const;
 
-        std::vector<svg::Text> GetBusLabels(const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& sp) const;
+        std::vector<svg::Text> GetBusLabels(const std::vector<domain::Bus*>& buses, const SphereProjector& sp) const;
 
         std::vector<svg::Text> GetStopLabels(const std::map<std::string_view, domain::Stop*>& stops, const SphereProjector& sp) const;
 
         std::vector<svg::Circle> GetStopCircles(const std::map<std::string_view, domain::Stop*>& stops, const SphereProjector& sp) const;
 
-        svg::Document GetSvgDocument(const std::map<std::string_view, domain::Bus*>& buses) const;
+        svg::Document GetSvgDocument(const std::vector<domain::Bus*>& buses) const;
+
+        // Рисует карту и сразу готовит её экранированный текст
+        MapText RenderText(const std::vector<domain::Bus*>& buses) const;
 
         json::Node GetRenderSettings() const;
 
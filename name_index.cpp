@@ -0,0 +1,191 @@
+#include "name_index.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace tc {
+
+    namespace {
+        using namespace std::literals;
+
+        // Среднее количество имён в одной корзине
+        const size_t BUCKET_LOAD = 4;
+        // Слотов на восьмую часть больше, чем имён: при полной таблице последним корзинам
+        // из одного имени пришлось бы перебирать порядка n смещений в поисках свободного слота
+        size_t GetSlotCount(size_t name_count) {
+            return name_count + name_count / 8 + 1;
+        }
+        // После стольких неудачных смещений для одной корзины меняем соль
+        uint32_t GetMaxDisplacement(size_t slot_count) {
+            return static_cast<uint32_t>(std::max<size_t>(1u << 16, slot_count));
+        }
+        // При свободных слотах смена соли нужна редко; столько смен подряд — ошибка построения
+        const uint64_t MAX_SALT = 64;
+
+        uint64_t HashName(std::string_view name, uint64_t salt) {
+            uint64_t h = 14695981039346656037ull ^ (salt * 0x9E3779B97F4A7C15ull);
+            for (const char c : name) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 1099511628211ull;
+            }
+            // У коротких имён FNV почти не перемешивает старшие биты, по которым выбирается корзина
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDull;
+            return h ^ (h >> 33);
+        }
+
+        uint64_t Mix(uint64_t h, uint32_t displacement) {
+            uint64_t x = h + (displacement + 1) * 0x9E3779B97F4A7C15ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        }
+
+        size_t BucketOf(uint64_t h, size_t bucket_count) {
+            return static_cast<size_t>(h >> 32) % bucket_count;
+        }
+    }
+
+    NameIndex::NameIndex(const std::vector<std::string_view>& names) {
+        if (names.empty()) return;
+        sorted_order_.resize(names.size());
+        std::iota(sorted_order_.begin(), sorted_order_.end(), 0u);
+        std::sort(sorted_order_.begin(), sorted_order_.end(),
+            [&names](uint32_t lhs, uint32_t rhs) { return names[lhs] < names[rhs]; });
+        // Одинаковые имена не различить никакой хеш-функцией, поэтому они проверяются заранее
+        const auto duplicate = std::adjacent_find(sorted_order_.begin(), sorted_order_.end(),
+            [&names](uint32_t lhs, uint32_t rhs) { return names[lhs] == names[rhs]; });
+        if (duplicate != sorted_order_.end()) {
+            throw std::invalid_argument("Duplicate name in index: "s + std::string(names[*duplicate]));
+        }
+
+        std::vector<uint64_t> hashes(names.size());
+        for (salt_ = 0;; ++salt_) {
+            for (size_t i = 0; i < names.size(); ++i) {
+                hashes[i] = HashName(names[i], salt_);
+            }
+            if (TryBuild(hashes)) break;
+            if (salt_ == MAX_SALT) {
+                throw std::runtime_error("Cannot build name index: no displacement fits after "s
+                    + std::to_string(MAX_SALT + 1) + " salts"s);
+            }
+        }
+    }
+
+    NameIndex::NameIndex(uint64_t salt, std::vector<uint32_t> displacements,
+        std::vector<uint32_t> slots, std::vector<uint32_t> sorted_order)
+        : salt_(salt)
+        , displacements_(std::move(displacements))
+        , slots_(std::move(slots))
+        , sorted_order_(std::move(sorted_order))
+    {
+        // Find возвращает содержимое слотов как номера в таблицах каталога, поэтому
+        // и слоты, и порядок должны быть перестановками номеров 0..n-1
+        const size_t n = sorted_order_.size();
+        const bool sizes_match = n == 0
+            ? slots_.empty() && displacements_.empty()
+            : slots_.size() >= n && !displacements_.empty();
+        if (!sizes_match) {
+            throw std::runtime_error("Inconsistent name index"s);
+        }
+        std::vector<bool> seen_in_slots(n, false);
+        size_t used_slots = 0;
+        for (const uint32_t id : slots_) {
+            if (id == EMPTY_SLOT) continue;
+            if (id >= n || seen_in_slots[id]) {
+                throw std::runtime_error("Inconsistent name index"s);
+            }
+            seen_in_slots[id] = true;
+            ++used_slots;
+        }
+        std::vector<bool> seen_in_order(n, false);
+        for (const uint32_t id : sorted_order_) {
+            if (id >= n || seen_in_order[id]) {
+                throw std::runtime_error("Inconsistent name index"s);
+            }
+            seen_in_order[id] = true;
+        }
+        if (used_slots != n) {
+            throw std::runtime_error("Inconsistent name index"s);
+        }
+    }
+
+    bool NameIndex::TryBuild(const std::vector<uint64_t>& hashes) {
+        const size_t n = hashes.size();
+        const size_t slot_count = GetSlotCount(n);
+        const uint32_t max_displacement = GetMaxDisplacement(slot_count);
+        const size_t bucket_count = (n + BUCKET_LOAD - 1) / BUCKET_LOAD;
+        std::vector<std::vector<uint32_t>> buckets(bucket_count);
+        for (uint32_t i = 0; i < n; ++i) {
+            buckets[BucketOf(hashes[i], bucket_count)].push_back(i);
+        }
+        std::vector<uint32_t> bucket_order(bucket_count);
+        std::iota(bucket_order.begin(), bucket_order.end(), 0u);
+        std::stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+            });
+
+        displacements_.assign(bucket_count, 0);
+        slots_.assign(slot_count, EMPTY_SLOT);
+        std::vector<bool> occupied(slot_count, false);
+        std::vector<size_t> positions;
+        for (const uint32_t b : bucket_order) {
+            const auto& bucket = buckets[b];
+            if (bucket.empty()) break;
+            bool placed = false;
+            for (uint32_t d = 0; d < max_displacement && !placed; ++d) {
+                positions.clear();
+                placed = true;
+                for (const uint32_t key : bucket) {
+                    const size_t pos = Mix(hashes[key], d) % slot_count;
+                    if (occupied[pos] || std::find(positions.begin(), positions.end(), pos) != positions.end()) {
+                        placed = false;
+                        break;
+                    }
+                    positions.push_back(pos);
+                }
+                if (placed) {
+                    displacements_[b] = d;
+                    for (size_t k = 0; k < bucket.size(); ++k) {
+                        occupied[positions[k]] = true;
+                        slots_[positions[k]] = bucket[k];
+                    }
+                }
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+    std::optional<uint32_t> NameIndex::Find(std::string_view name) const {
+        if (slots_.empty()) return std::nullopt;
+        const uint64_t h = HashName(name, salt_);
+        const uint32_t d = displacements_[BucketOf(h, displacements_.size())];
+        const uint32_t id = slots_[Mix(h, d) % slots_.size()];
+        if (id == EMPTY_SLOT) return std::nullopt;
+        return id;
+    }
+
+    size_t NameIndex::Size() const {
+        return sorted_order_.size();
+    }
+
+    uint64_t NameIndex::GetSalt() const {
+        return salt_;
+    }
+
+    const std::vector<uint32_t>& NameIndex::GetDisplacements() const {
+        return displacements_;
+    }
+
+    const std::vector<uint32_t>& NameIndex::GetSlots() const {
+        return slots_;
+    }
+
+    const std::vector<uint32_t>& NameIndex::GetSortedOrder() const {
+        return sorted_order_;
+    }
+
+} // namespace tc
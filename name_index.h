@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace tc {
+
+    // Совершенная хеш-функция (схема hash-and-displace) над набором имён.
+    // Каждому имени соответствует свой слот, поэтому поиск — это один хеш
+    // и одно сравнение строк на стороне вызывающего кода.
+    class NameIndex {
+    public:
+        NameIndex() = default;
+
+        // Строит индекс над names; позиция имени в векторе считается его порядковым номером.
+        // Бросает std::invalid_argument, если имена повторяются
+        explicit NameIndex(const std::vector<std::string_view>& names);
+
+        // Восстанавливает ранее построенный индекс (например, из базы). Бросает
+        // std::runtime_error, если слоты и порядок не перестановки номеров имён
+        NameIndex(uint64_t salt, std::vector<uint32_t> displacements,
+            std::vector<uint32_t> slots, std::vector<uint32_t> sorted_order);
+
+        // Возвращает единственного кандидата для name; совпадение имени проверяет вызывающий
+        std::optional<uint32_t> Find(std::string_view name) const;
+
+        // Количество имён; слотов в таблице немного больше
+        size_t Size() const;
+
+        uint64_t GetSalt() const;
+
+        const std::vector<uint32_t>& GetDisplacements() const;
+
+        // Номера имён по слотам, EMPTY_SLOT — свободный слот
+        const std::vector<uint32_t>& GetSlots() const;
+
+        // Порядковые номера имён в лексикографическом порядке
+        const std::vector<uint32_t>& GetSortedOrder() const;
+
+        static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    private:
+        uint64_t salt_ = 0;
+        std::vector<uint32_t> displacements_;
+        std::vector<uint32_t> slots_;
+        std::vector<uint32_t> sorted_order_;
+
+        bool TryBuild(const std::vector<uint64_t>& hashes);
+    };
+
+} // namespace tc
@@ -0,0 +1,142 @@
+#include "prefix_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tc {
+
+    namespace {
+        using namespace std::literals;
+
+        void WriteVarint(std::string& out, size_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        size_t ReadVarint(const char*& pos) {
+            size_t result = 0;
+            for (int shift = 0;; shift += 7) {
+                const auto byte = static_cast<unsigned char>(*pos++);
+                result |= static_cast<size_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            return result;
+        }
+
+        size_t CommonPrefix(std::string_view lhs, std::string_view rhs) {
+            const size_t limit = std::min(lhs.size(), rhs.size());
+            size_t i = 0;
+            while (i < limit && lhs[i] == rhs[i]) {
+                ++i;
+            }
+            return i;
+        }
+
+        // Запись: длина общего префикса, длина остатка, вид, остаток
+        struct Record {
+            size_t shared;
+            std::string_view suffix;
+            PrefixIndex::Kind kind;
+        };
+
+        Record ReadRecord(const char*& pos) {
+            Record result;
+            result.shared = ReadVarint(pos);
+            const size_t suffix_size = ReadVarint(pos);
+            result.kind = static_cast<PrefixIndex::Kind>(*pos++);
+            result.suffix = { pos, suffix_size };
+            pos += suffix_size;
+            return result;
+        }
+    }
+
+    PrefixIndex::PrefixIndex(std::vector<std::pair<std::string_view, Kind>> names)
+        : size_(names.size())
+    {
+        std::sort(names.begin(), names.end());
+        std::string_view previous;
+        for (size_t i = 0; i < names.size(); ++i) {
+            const auto& [name, kind] = names[i];
+            const size_t shared = i % BLOCK_SIZE == 0 ? 0 : CommonPrefix(previous, name);
+            if (i % BLOCK_SIZE == 0) {
+                block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+            }
+            WriteVarint(data_, shared);
+            WriteVarint(data_, name.size() - shared);
+            data_.push_back(static_cast<char>(kind));
+            data_.append(name.substr(shared));
+            previous = name;
+        }
+    }
+
+    PrefixIndex::PrefixIndex(std::string data, std::vector<uint32_t> block_offsets, size_t size)
+        : data_(std::move(data))
+        , block_offsets_(std::move(block_offsets))
+        , size_(size)
+    {
+        if (block_offsets_.size() != (size_ + BLOCK_SIZE - 1) / BLOCK_SIZE
+            || std::any_of(block_offsets_.begin(), block_offsets_.end(),
+                [this](uint32_t offset) { return offset >= data_.size(); })) {
+            throw std::invalid_argument("Inconsistent prefix index"s);
+        }
+    }
+
+    std::vector<PrefixIndex::Entry> PrefixIndex::Suggest(std::string_view prefix, size_t count) const {
+        std::vector<Entry> result;
+        if (size_ == 0 || count == 0) return result;
+
+        // Последний блок, первое имя которого меньше префикса: подходящие имена начинаются в нём или позже
+        size_t first_not_less = 0;
+        size_t last = block_offsets_.size();
+        while (first_not_less < last) {
+            const size_t middle = first_not_less + (last - first_not_less) / 2;
+            if (GetBlockHead(middle) < prefix) {
+                first_not_less = middle + 1;
+            }
+            else {
+                last = middle;
+            }
+        }
+        size_t block = first_not_less == 0 ? 0 : first_not_less - 1;
+
+        std::string name;
+        for (; block < block_offsets_.size(); ++block) {
+            const char* pos = data_.data() + block_offsets_[block];
+            const size_t block_end = std::min(size_, (block + 1) * BLOCK_SIZE);
+            for (size_t i = block * BLOCK_SIZE; i < block_end; ++i) {
+                const Record record = ReadRecord(pos);
+                name.resize(record.shared);
+                name.append(record.suffix);
+                if (std::string_view(name).substr(0, prefix.size()) == prefix) {
+                    result.push_back({ name, record.kind });
+                    if (result.size() == count) return result;
+                }
+                else if (name > prefix) {
+                    return result;
+                }
+            }
+        }
+        return result;
+    }
+
+    size_t PrefixIndex::Size() const {
+        return size_;
+    }
+
+    const std::string& PrefixIndex::GetData() const {
+        return data_;
+    }
+
+    const std::vector<uint32_t>& PrefixIndex::GetBlockOffsets() const {
+        return block_offsets_;
+    }
+
+    std::string_view PrefixIndex::GetBlockHead(size_t block) const {
+        const char* pos = data_.data() + block_offsets_[block];
+        return ReadRecord(pos).suffix;
+    }
+
+} // namespace tc
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tc {
+
+    // Отсортированный список имён с front coding: в каждом блоке первое имя хранится
+    // целиком, остальные — длиной общего с предыдущим префикса и остатком
+    class PrefixIndex {
+    public:
+        enum class Kind : uint8_t {
+            STOP,
+            BUS
+        };
+
+        struct Entry {
+            std::string name;
+            Kind kind;
+        };
+
+        PrefixIndex() = default;
+
+        // Имена могут идти в любом порядке и повторяться для разных видов
+        explicit PrefixIndex(std::vector<std::pair<std::string_view, Kind>> names);
+
+        // Восстанавливает индекс из базы
+        PrefixIndex(std::string data, std::vector<uint32_t> block_offsets, size_t size);
+
+        // Не более count имён, начинающихся с prefix, в лексикографическом порядке
+        std::vector<Entry> Suggest(std::string_view prefix, size_t count) const;
+
+        size_t Size() const;
+
+        const std::string& GetData() const;
+
+        const std::vector<uint32_t>& GetBlockOffsets() const;
+
+    private:
+        static const size_t BLOCK_SIZE = 16;
+
+        std::string data_;
+        std::vector<uint32_t> block_offsets_;
+        size_t size_ = 0;
+
+        std::string_view GetBlockHead(size_t block) const;
+    };
+
+} // namespace tc
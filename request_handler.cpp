@@ -1,67 +1,141 @@
 #include "request_handler.h"
 
+#include <algorithm>
 #include <utility>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_set>
+#include <variant>
 
 using namespace std;
 using namespace tc;
 using namespace domain;
 
-RequestHandler::RequestHandler(const tc::Catalogue& catalogue,
-    const tc::Router& router, const renderer::MapRenderer& renderer)
-    : db_(catalogue)
+namespace {
+    // Столько ответов параллельного режима держится в памяти до вывода
+    const size_t WINDOW_SIZE = 512;
+    // Потоки забирают из окна куски по нескольку запросов, чтобы дорогая отрисовка карты
+    // в одном куске не задерживала остальные: свободный поток просто берёт следующий
+    const size_t GRAIN = 4;
+
+    // Выполняет запросы окнами на общем пуле; write получает результаты в порядке запросов
+    template <typename Result, typename Execute, typename Write>
+    void ExecuteInWindows(const vector<requests::StatRequest>& batch, Execute execute, Write write) {
+        ThreadPool& pool = ThreadPool::GetShared();
+        vector<Result> results;
+        for (size_t begin = 0; begin < batch.size(); begin += WINDOW_SIZE) {
+            const size_t size = min(WINDOW_SIZE, batch.size() - begin);
+            results.clear();
+            results.resize(size);
+            pool.ParallelFor(size, GRAIN, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i) {
+                    results[i] = execute(batch[begin + i]);
+                }
+            });
+            for (const Result& result : results) {
+                write(result);
+            }
+        }
+    }
+}
+
+RequestHandler::RequestHandler(const tc::CatalogueHolder& catalogues,
+    const Lazy<tc::Router>& router, const Lazy<renderer::MapRenderer>& renderer,
+    const Lazy<std::optional<renderer::MapText>>& stored_map,
+    Execution execution)
+    : catalogues_(catalogues)
     , router_(router)
-    , renderer_(renderer) {}
+    , renderer_(renderer)
+    , stored_map_(stored_map)
+    , stored_map_db_(catalogues.Acquire())
+    , execution_(execution) {}
 
-void RequestHandler::JsonStatRequests(const json::Node& json_input, std::ostream& output)
+void RequestHandler::JsonStatRequests(const json::Node& json_input, std::ostream& output, const json::PrintSettings& settings)
 {
-    const json::Array& arr = json_input.AsArray();
-    json::Array output_array;
-    output_array.reserve(arr.size());
-    for (auto& request_node : arr) {
-        const json::Dict& request_map = request_node.AsDict();
-        const string& type = request_map.at("type"s).AsString();
-        if (type == "Stop"s) {
-            output_array.push_back(FindStopRequestProcessing(request_map));
-            continue;
-        }
-        if (type == "Bus"s) {
-            output_array.push_back(FindBusRequestProcessing(request_map));
-            continue;
-        }
-        if (type == "Map"s) {
-            output_array.push_back(BuildMapRequestProcessing(request_map));
-            continue;
-        }
-        if (type == "Route"s) {
-            output_array.push_back(BuildRouteRequestProcessing(request_map));
-            continue;
+    const CatalogueHolder::Snapshot db = catalogues_.Acquire();
+    const vector<requests::StatRequest> batch = requests::Decode(json_input, *db);
+    // Ответы Map ссылаются на текст карты, поэтому пакет удерживает её до конца вывода
+    const shared_ptr<const RenderedMap> map = GetBatchMap(db, batch);
+    json::ArrayWriter writer(output, settings);
+    if (execution_ == Execution::PARALLEL) {
+        // Ответы печатаются в тех же потоках, писателю остаётся склеить готовый текст
+        ExecuteInWindows<string>(batch,
+            [&](const requests::StatRequest& request) {
+                return json::ArrayWriter::PrintElement(Execute(*db, map.get(), request), settings);
+            },
+            [&writer](const string& element) { writer.AddPrinted(element); });
+    }
+    else {
+        for (const requests::StatRequest& request : batch) {
+            writer.Add(Execute(*db, map.get(), request));
         }
     }
-    json::Print(json::Document(json::Node(move(output_array))), output);
+    writer.Finish();
 }
 
 svg::Document RequestHandler::RenderMap() const
 {
-    return renderer_.GetSvgDocument(db_.GetSortedAllBuses());
+    return renderer_.Get().GetSvgDocument(catalogues_.Acquire()->GetSortedAllBuses());
+}
+
+void RequestHandler::BinaryStatRequests(const protocol::RequestBatch& batch, std::ostream& output)
+{
+    const CatalogueHolder::Snapshot db = catalogues_.Acquire();
+    const vector<requests::StatRequest> decoded = protocol::Decode(batch, *db);
+    const shared_ptr<const RenderedMap> map = GetBatchMap(db, decoded);
+    protocol::ResponseWriter writer(output, batch.with_names());
+    if (execution_ == Execution::PARALLEL) {
+        ExecuteInWindows<protocol::StatResponse>(decoded,
+            [&](const requests::StatRequest& request) { return ExecuteBinary(*db, map.get(), request); },
+            [&writer](const protocol::StatResponse& response) { writer.Add(response); });
+    }
+    else {
+        for (const requests::StatRequest& request : decoded) {
+            writer.Add(ExecuteBinary(*db, map.get(), request));
+        }
+    }
+    writer.Finish(*db);
+}
+
+json::Node RequestHandler::Execute(const Catalogue& db, const RenderedMap* map, const requests::StatRequest& request)
+{
+    return visit([this, &db, map, id = request.id](const auto& query) {
+        using Query = decay_t<decltype(query)>;
+        if constexpr (is_same_v<Query, requests::StopRequest>) {
+            return FindStopRequestProcessing(db, id, query);
+        }
+        else if constexpr (is_same_v<Query, requests::BusRequest>) {
+            return FindBusRequestProcessing(id, query);
+        }
+        else if constexpr (is_same_v<Query, requests::MapRequest>) {
+            return BuildMapRequestProcessing(*map, id);
+        }
+        else if constexpr (is_same_v<Query, requests::RouteRequest>) {
+            return BuildRouteRequestProcessing(id, query);
+        }
+        else if constexpr (is_same_v<Query, requests::NearestStopsRequest>) {
+            return NearestStopsRequestProcessing(db, id, query);
+        }
+        else {
+            return SuggestRequestProcessing(db, id, query);
+        }
+    }, request.query);
 }
 
-json::Node RequestHandler::FindStopRequestProcessing(const json::Dict& request_map)
+json::Node RequestHandler::FindStopRequestProcessing(const Catalogue& db, int id, const requests::StopRequest& request)
 {
-    int id = request_map.at("id"s).AsInt();
-    const string& name = request_map.at("name"s).AsString();
-    if (const Stop* stop = db_.FindStop(name)) {
+    if (const Stop* stop = request.stop) {
         json::Array buses_array;
-        const auto& buses_on_stop = db_.GetBusesOnStop(stop->name);
+        const auto& buses_on_stop = db.GetBusesOnStop(stop->name);
         buses_array.reserve(buses_on_stop.size());
         for (auto& [bus_name, bus] : buses_on_stop) {
-            buses_array.push_back(bus->name);
+            buses_array.push_back(string(bus->name));
         }
-        return json::Node(json::Dict{
-                {{"buses"s},{move(buses_array)}},
-                {{"request_id"s},{id}}
-            });
+        return json::Builder{}.StartDict()
+            .Key("buses"s).Value(move(buses_array))
+            .Key("request_id"s).Value(id)
+            .EndDict().Build();
     }
     else {
         return json::Builder{}.StartDict()
@@ -71,29 +145,15 @@ json::Node RequestHandler::FindStopRequestProcessing(const json::Dict& request_m
     }
 }
 
-json::Node RequestHandler::FindBusRequestProcessing(const json::Dict& request_map)
+json::Node RequestHandler::FindBusRequestProcessing(int id, const requests::BusRequest& request)
 {
-    int id = request_map.at("id"s).AsInt();
-    const string& name = request_map.at("name"s).AsString();
-    if (const Bus* bus = db_.FindBus(name)) {
-        int stops_count = bus->stops.size();
-        int distance = 0;
-        double straight_distance = 0.0;
-        for (int i = 1; i < stops_count; ++i) {
-            distance += bus->stops[i - 1]->GetDistance(bus->stops[i]);
-            straight_distance += geo::ComputeDistance(bus->stops[i - 1]->coordinates, bus->stops[i]->coordinates);
-        }
-        double curvature = distance / straight_distance;
-        unordered_set<string> unique_stops_set;
-        for (tc::Stop* s : bus->stops) {
-            unique_stops_set.emplace(s->name);
-        }
-        int unique_stops = unique_stops_set.size();
+    if (const Bus* bus = request.bus) {
+        const BusStat stat = ComputeBusStat(*bus);
         return json::Node(json::Dict{
-                {{"route_length"s},{distance}},
-                {{"unique_stop_count"s},{unique_stops}},
-                {{"stop_count"s},{stops_count}},
-                {{"curvature"s},{curvature}},
+                {{"route_length"s},{stat.route_length}},
+                {{"unique_stop_count"s},{stat.unique_stop_count}},
+                {{"stop_count"s},{stat.stop_count}},
+                {{"curvature"s},{stat.curvature}},
                 {{"request_id"s},{id}}
             });
     }
@@ -105,32 +165,25 @@ json::Node RequestHandler::FindBusRequestProcessing(const json::Dict& request_ma
     }
 }
 
-json::Node RequestHandler::BuildMapRequestProcessing(const json::Dict& request_map)
+json::Node RequestHandler::BuildMapRequestProcessing(const RenderedMap& map, int id)
 {
-    int id = request_map.at("id"s).AsInt();
-    svg::Document map = RenderMap();
-    ostringstream strm;
-    map.Render(strm);
-    return json::Node(json::Dict{
-                {{"map"s},{strm.str()}},
-                {{"request_id"s},{id}}
-        });
+    return json::Builder{}.StartDict()
+        .Key("map"s).Value(json::StringRef{ map.text.svg, map.text.escaped })
+        .Key("request_id"s).Value(id)
+        .EndDict().Build();
 }
 
-json::Node RequestHandler::BuildRouteRequestProcessing(const json::Dict& request_map)
+json::Node RequestHandler::BuildRouteRequestProcessing(int id, const requests::RouteRequest& request)
 {
-    int id = request_map.at("id"s).AsInt();
-    const string& name_from = request_map.at("from"s).AsString();
-    const string& name_to = request_map.at("to"s).AsString();
-    if (const Stop* stop_from = db_.FindStop(name_from)) {
-        if (const Stop* stop_to = db_.FindStop(name_to)) {
-            if (auto ri = router_.GetRouteInfo(stop_from, stop_to)) {
+    if (const Stop* stop_from = request.from) {
+        if (const Stop* stop_to = request.to) {
+            if (auto ri = router_.Get().GetRouteInfo(stop_from, stop_to)) {
                 auto [wieght, edges] = ri.value();
-                return json::Node(json::Dict{
-                    {{"items"s},{router_.GetEdgesItems(edges)}},
-                    {{"total_time"s},{wieght}},
-                    {{"request_id"s},{id}}
-                    });
+                return json::Builder{}.StartDict()
+                    .Key("items"s).Value(router_.Get().GetEdgesItems(edges))
+                    .Key("total_time"s).Value(wieght)
+                    .Key("request_id"s).Value(id)
+                    .EndDict().Build();
             }
         }
     }
@@ -138,4 +191,149 @@ json::Node RequestHandler::BuildRouteRequestProcessing(const json::Dict& request
         .Key("error_message"s).Value("not found"s)
         .Key("request_id"s).Value(id)
         .EndDict().Build();
+}
+
+json::Node RequestHandler::NearestStopsRequestProcessing(const Catalogue& db, int id, const requests::NearestStopsRequest& request)
+{
+    json::Array stops_array;
+    for (const auto& [stop, distance] : db.FindNearestStops(request.from, request.count)) {
+        stops_array.push_back(json::Node(json::Dict{
+                {{"name"s},{string(stop->name)}},
+                {{"distance"s},{distance}}
+            }));
+    }
+    return json::Builder{}.StartDict()
+        .Key("stops"s).Value(move(stops_array))
+        .Key("request_id"s).Value(id)
+        .EndDict().Build();
+}
+
+json::Node RequestHandler::SuggestRequestProcessing(const Catalogue& db, int id, const requests::SuggestRequest& request)
+{
+    json::Array items_array;
+    for (auto& [name, kind] : db.SuggestNames(request.prefix, request.count)) {
+        items_array.push_back(json::Node(json::Dict{
+                {{"name"s},{move(name)}},
+                {{"type"s},{kind == PrefixIndex::Kind::STOP ? "Stop"s : "Bus"s}}
+            }));
+    }
+    return json::Builder{}.StartDict()
+        .Key("items"s).Value(move(items_array))
+        .Key("request_id"s).Value(id)
+        .EndDict().Build();
+}
+protocol::StatResponse RequestHandler::ExecuteBinary(const Catalogue& db, const RenderedMap* map, const requests::StatRequest& request)
+{
+    protocol::StatResponse response;
+    response.set_request_id(request.id);
+    visit([this, &db, map, &response](const auto& query) {
+        using Query = decay_t<decltype(query)>;
+        if constexpr (is_same_v<Query, requests::StopRequest>) {
+            if (!query.stop) {
+                response.set_not_found(true);
+                return;
+            }
+            protocol::StopAnswer& answer = *response.mutable_stop();
+            for (const auto& [bus_name, bus] : db.GetBusesOnStop(query.stop->name)) {
+                answer.add_bus_id(db.GetBusId(bus));
+            }
+        }
+        else if constexpr (is_same_v<Query, requests::BusRequest>) {
+            if (!query.bus) {
+                response.set_not_found(true);
+                return;
+            }
+            const BusStat stat = ComputeBusStat(*query.bus);
+            protocol::BusAnswer& answer = *response.mutable_bus();
+            answer.set_curvature(stat.curvature);
+            answer.set_route_length(stat.route_length);
+            answer.set_stop_count(stat.stop_count);
+            answer.set_unique_stop_count(stat.unique_stop_count);
+        }
+        else if constexpr (is_same_v<Query, requests::RouteRequest>) {
+            const auto route = query.from && query.to ? router_.Get().GetRouteInfo(query.from, query.to) : nullopt;
+            if (!route) {
+                response.set_not_found(true);
+                return;
+            }
+            protocol::RouteAnswer& answer = *response.mutable_route();
+            answer.set_total_time(route->weight);
+            const auto& graph = router_.Get().GetGraph();
+            for (const graph::EdgeId edge_id : route->edges) {
+                const graph::Edge<double>& edge = graph.GetEdge(edge_id);
+                protocol::RouteItem& item = *answer.add_item();
+                // Маршрутизатор знает остановки и маршруты только по именам, а номера в ответе
+                // относятся к версии каталога db; расхождение — ошибка, а не нулевой указатель
+                if (edge.quality == 0) {
+                    const Stop* stop = db.FindStop(edge.name);
+                    if (!stop) {
+                        throw runtime_error("Route passes stop missing from the catalogue: "s + edge.name);
+                    }
+                    item.set_wait_stop_id(db.GetStopId(stop));
+                }
+                else {
+                    const Bus* bus = db.FindBus(edge.name);
+                    if (!bus) {
+                        throw runtime_error("Route uses bus missing from the catalogue: "s + edge.name);
+                    }
+                    item.set_bus_id(db.GetBusId(bus));
+                    item.set_span_count(static_cast<int>(edge.quality));
+                }
+                item.set_time(edge.weight);
+            }
+        }
+        else if constexpr (is_same_v<Query, requests::MapRequest>) {
+            response.mutable_map()->set_svg(string(map->text.svg));
+        }
+        else {
+            throw invalid_argument("Request type is not supported by the binary protocol"s);
+        }
+    }, request.query);
+    return response;
+}
+
+RequestHandler::BusStat RequestHandler::ComputeBusStat(const Bus& bus)
+{
+    BusStat stat;
+    stat.stop_count = static_cast<int>(bus.stops.size());
+    double straight_distance = 0.0;
+    for (int i = 1; i < stat.stop_count; ++i) {
+        stat.route_length += bus.stops[i - 1]->GetDistance(bus.stops[i]);
+        straight_distance += geo::ComputeDistance(bus.stops[i - 1]->coordinates, bus.stops[i]->coordinates);
+    }
+    stat.curvature = stat.route_length / straight_distance;
+    unordered_set<string_view> unique_stops_set;
+    for (const tc::Stop* s : bus.stops) {
+        unique_stops_set.emplace(s->name);
+    }
+    stat.unique_stop_count = static_cast<int>(unique_stops_set.size());
+    return stat;
+}
+
+shared_ptr<const RequestHandler::RenderedMap> RequestHandler::GetRenderedMap(const CatalogueHolder::Snapshot& db) const
+{
+    lock_guard<mutex> guard(map_mutex_);
+    if (!map_ || map_->db != db) {
+        auto map = make_shared<RenderedMap>();
+        map->db = db;
+        // Сравниваются владельцы: слабая ссылка не даёт адресу старой версии достаться новой
+        const bool stored_version = !stored_map_db_.owner_before(db) && !db.owner_before(stored_map_db_);
+        if (stored_version && stored_map_.Get()) {
+            map->text = *stored_map_.Get();
+        }
+        else {
+            map->text = renderer_.Get().RenderText(db->GetSortedAllBuses());
+        }
+        map_ = move(map);
+    }
+    return map_;
+}
+
+shared_ptr<const RequestHandler::RenderedMap> RequestHandler::GetBatchMap(const CatalogueHolder::Snapshot& db,
+    const vector<requests::StatRequest>& batch) const
+{
+    const bool has_map = any_of(batch.begin(), batch.end(), [](const requests::StatRequest& request) {
+        return holds_alternative<requests::MapRequest>(request.query);
+    });
+    return has_map ? GetRenderedMap(db) : nullptr;
 }
\ No newline at end of file
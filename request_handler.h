@@ -6,27 +6,86 @@
 #include "json.h"
 #include "map_renderer.h"
 #include "json_builder.h"
+#include "lazy.h"
+#include "stat_protocol.h"
+#include "stat_requests.h"
+#include "thread_pool.h"
 
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <utility>
 #include <string>
 #include <string_view>
 
+// Как выполнять пакет запросов; вывод в обоих режимах совпадает байт в байт
+enum class Execution {
+    SEQUENTIAL,
+    // Окна запросов разбираются потоками общего пула, ответы выводятся по порядку
+    PARALLEL
+};
+
 class RequestHandler {
 public:
-    RequestHandler(const tc::Catalogue& catalogue,
-        const tc::Router& router, const renderer::MapRenderer& renderer);
+    // Маршрутизатор и отрисовщик загружаются при первом запросе, которому они нужны.
+    // stored_map — карта, сохранённая в базе вместе с текущей версией каталога: пока версия
+    // не сменилась, запросы Map отвечаются ею, и отрисовщик не загружается вовсе
+    RequestHandler(const tc::CatalogueHolder& catalogues,
+        const Lazy<tc::Router>& router, const Lazy<renderer::MapRenderer>& renderer,
+        const Lazy<std::optional<renderer::MapText>>& stored_map,
+        Execution execution = Execution::SEQUENTIAL);
+
+    // Запросы сначала разбираются над одной закреплённой версией каталога, затем выполняются
+    // над ней же; ответ выводится сразу, как только готов (в параллельном режиме — окно ответов)
+    void JsonStatRequests(const json::Node& json_doc, std::ostream& output,
+        const json::PrintSettings& settings = {});
 
-    void JsonStatRequests(const json::Node& json_doc, std::ostream& output);
+    // То же для двоичного протокола, см. stat_protocol.proto
+    void BinaryStatRequests(const protocol::RequestBatch& batch, std::ostream& output);
 
     svg::Document RenderMap() const;
 
 private:
-    const tc::Catalogue& db_;
-    const tc::Router& router_;
-    const renderer::MapRenderer& renderer_;
-
-    json::Node FindStopRequestProcessing(const json::Dict& request_map);
-    json::Node FindBusRequestProcessing(const json::Dict& request_map);
-    json::Node BuildMapRequestProcessing(const json::Dict& request_map);
-    json::Node BuildRouteRequestProcessing(const json::Dict& request_map);
+    const tc::CatalogueHolder& catalogues_;
+    const Lazy<tc::Router>& router_;
+    const Lazy<renderer::MapRenderer>& renderer_;
+    const Lazy<std::optional<renderer::MapText>>& stored_map_;
+    // Версия, к которой относится stored_map_; слабая ссылка не держит старую версию в памяти
+    std::weak_ptr<const tc::Catalogue> stored_map_db_;
+    Execution execution_;
+
+    // Карта зависит только от версии каталога и настроек отрисовки, поэтому рисуется один раз на версию
+    struct RenderedMap {
+        // Удерживает версию, по которой нарисована карта
+        tc::CatalogueHolder::Snapshot db;
+        renderer::MapText text;
+    };
+
+    mutable std::mutex map_mutex_;
+    mutable std::shared_ptr<const RenderedMap> map_;
+
+    struct BusStat {
+        int route_length = 0;
+        int unique_stop_count = 0;
+        int stop_count = 0;
+        double curvature = 0.0;
+    };
+
+    // map — карта версии db, если в пакете есть запросы Map
+    json::Node Execute(const tc::Catalogue& db, const RenderedMap* map, const requests::StatRequest& request);
+    protocol::StatResponse ExecuteBinary(const tc::Catalogue& db, const RenderedMap* map, const requests::StatRequest& request);
+
+    json::Node FindStopRequestProcessing(const tc::Catalogue& db, int id, const requests::StopRequest& request);
+    json::Node FindBusRequestProcessing(int id, const requests::BusRequest& request);
+    json::Node BuildMapRequestProcessing(const RenderedMap& map, int id);
+    json::Node BuildRouteRequestProcessing(int id, const requests::RouteRequest& request);
+    json::Node NearestStopsRequestProcessing(const tc::Catalogue& db, int id, const requests::NearestStopsRequest& request);
+    json::Node SuggestRequestProcessing(const tc::Catalogue& db, int id, const requests::SuggestRequest& request);
+
+    static BusStat ComputeBusStat(const tc::Bus& bus);
+    // Рисует карту для db, только если закэшированная нарисована по другой версии, а в базе её нет
+    std::shared_ptr<const RenderedMap> GetRenderedMap(const tc::CatalogueHolder::Snapshot& db) const;
+    // Карта нужна, только если в пакете есть запросы Map
+    std::shared_ptr<const RenderedMap> GetBatchMap(const tc::CatalogueHolder::Snapshot& db,
+        const std::vector<requests::StatRequest>& batch) const;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "graph.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
@@ -20,7 +21,8 @@ namespace graph {
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
-        explicit Router(const Graph& graph);
+        // С пулом строки таблицы маршрутов на каждом шаге пересчитываются параллельно
+        explicit Router(const Graph& graph, ThreadPool* pool = nullptr);
 
         struct RouteInfo {
             Weight weight;
@@ -63,8 +65,11 @@ namespace graph {
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+        // Строка и столбец vertex_through на этом шаге не меняются, поэтому строки
+        // [from_begin, from_end) можно пересчитывать независимо от остальных
+        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through,
+            VertexId from_begin, VertexId from_end) {
+            for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
                 if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
                     for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
                         if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
@@ -81,7 +86,7 @@ namespace graph {
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, ThreadPool* pool)
         : graph_(graph)
         , routes_internal_data_(graph.GetVertexCount(),
             std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
@@ -89,8 +94,17 @@ namespace graph {
         InitializeRoutesInternalData(graph);
 
         const size_t vertex_count = graph.GetVertexCount();
+        // Чтобы накладные расходы на задачу окупались, кусок должен содержать порядка 64K ячеек
+        const size_t grain = std::max<size_t>(1, (1u << 16) / std::max<size_t>(vertex_count, 1));
         for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+            if (pool) {
+                pool->ParallelFor(vertex_count, grain, [this, vertex_count, vertex_through](size_t begin, size_t end) {
+                    RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through, begin, end);
+                    });
+            }
+            else {
+                RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through, 0, vertex_count);
+            }
         }
     }
 
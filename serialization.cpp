@@ -1,43 +1,103 @@
 #include "serialization.h"
+#include "compressed_base.h"
+#include "flat_base.h"
+#include "stream_base.h"
 
 using namespace std;
 
+namespace {
+    // Версия 2: имена хранятся один раз в string_table, остальные сообщения ссылаются на них номерами
+    const uint32_t DB_VERSION = 2;
+    // Столько рёбер или вершин графа разбирает одна задача пула
+    const size_t GRAPH_CHUNK_SIZE = 4096;
+}
+
 void Serialize(const tc::Catalogue& tcat,
     const renderer::MapRenderer& renderer, const tc::Router& router,
+    const std::optional<renderer::MapText>& map,
     std::ostream& output) {
     serialize::TransportCatalogue database;
-    for (const auto& [name, s] : tcat.GetSortedAllStops()) {
-        *database.add_stop() = Serialize(s);
+    database.set_version(DB_VERSION);
+    // Сначала имена остановок, чтобы номер строки совпадал с номером остановки
+    NameIds ids;
+    for (const auto& s : tcat.GetAllStops()) {
+        ids.emplace(s->name, database.string_table_size());
+        database.add_string_table(static_cast<string>(s->name));
+    }
+    for (const auto& b : tcat.GetAllBuses()) {
+        ids.emplace(b->name, database.string_table_size());
+        database.add_string_table(static_cast<string>(b->name));
     }
-    for (const auto& [name, b] : tcat.GetSortedAllBuses()) {
-        *database.add_bus() = Serialize(b);
+    for (const auto& s : tcat.GetAllStops()) {
+        *database.add_stop() = Serialize(s.get(), ids);
     }
+    for (const auto& b : tcat.GetAllBuses()) {
+        *database.add_bus() = Serialize(b.get(), ids);
+    }
+    *database.mutable_stop_index() = Serialize(tcat.GetStopIndex());
+    *database.mutable_bus_index() = Serialize(tcat.GetBusIndex());
+    *database.mutable_stop_grid() = Serialize(tcat.GetStopGrid());
+    *database.mutable_name_prefixes() = Serialize(tcat.GetNamePrefixes());
     *database.mutable_render_settings() = GetRenderSettingSerialize(renderer.GetRenderSettings());
-    *database.mutable_router() = Serialize(router);
+    *database.mutable_router() = Serialize(router, ids);
+    if (map) {
+        *database.mutable_map() = Serialize(*map);
+    }
     database.SerializeToOstream(&output);
 }
 
-serialize::Stop Serialize(const tc::Stop* stop) {
+serialize::Stop Serialize(const tc::Stop* stop, const NameIds& ids) {
     serialize::Stop result;
-    result.set_name(stop->name);
+    result.set_name_id(ids.at(stop->name));
     result.add_coordinate(stop->coordinates.lat);
     result.add_coordinate(stop->coordinates.lng);
     for (const auto& [n, d] : stop->stop_distances) {
-        result.add_near_stop(static_cast<string>(n));
+        result.add_near_stop_id(ids.at(n));
         result.add_distance(d);
     }
     return result;
 }
 
-serialize::Bus Serialize(const tc::Bus* bus) {
+serialize::Bus Serialize(const tc::Bus* bus, const NameIds& ids) {
     serialize::Bus result;
-    result.set_name(bus->name);
+    result.set_name_id(ids.at(bus->name));
     for (const auto& s : bus->stops) {
-        result.add_stop(s->name);
+        result.add_stop_id(ids.at(s->name));
     }
     result.set_is_circle(bus->is_circle);
     if (bus->final_stop)
-        result.set_final_stop(bus->final_stop->name);
+        result.set_final_stop_id(ids.at(bus->final_stop->name) + 1);
+    return result;
+}
+
+serialize::NameIndex Serialize(const tc::NameIndex& index) {
+    serialize::NameIndex result;
+    result.set_salt(index.GetSalt());
+    *result.mutable_displacement() = { index.GetDisplacements().begin(), index.GetDisplacements().end() };
+    *result.mutable_slot() = { index.GetSlots().begin(), index.GetSlots().end() };
+    *result.mutable_sorted_order() = { index.GetSortedOrder().begin(), index.GetSortedOrder().end() };
+    return result;
+}
+
+serialize::SpatialIndex Serialize(const tc::SpatialIndex& grid) {
+    serialize::SpatialIndex result;
+    const tc::SpatialIndex::Layout& layout = grid.GetLayout();
+    result.set_min_lat(layout.min.lat);
+    result.set_min_lng(layout.min.lng);
+    result.set_max_lat(layout.max.lat);
+    result.set_max_lng(layout.max.lng);
+    result.set_rows(layout.rows);
+    result.set_cols(layout.cols);
+    *result.mutable_cell_start() = { grid.GetCellStart().begin(), grid.GetCellStart().end() };
+    *result.mutable_item() = { grid.GetItems().begin(), grid.GetItems().end() };
+    return result;
+}
+
+serialize::PrefixIndex Serialize(const tc::PrefixIndex& prefixes) {
+    serialize::PrefixIndex result;
+    result.set_data(prefixes.GetData());
+    *result.mutable_block_offset() = { prefixes.GetBlockOffsets().begin(), prefixes.GetBlockOffsets().end() };
+    result.set_size(prefixes.Size());
     return result;
 }
 
@@ -69,7 +129,7 @@ serialize::Color GetColorSerialize(const json::Node& node) {
         }
     }
     else if (node.IsString()) {
-        result.set_name(node.AsString());
+        result.set_name(string(node.AsString()));
     }
     return result;
 }
@@ -102,72 +162,152 @@ serialize::RouterSettings GetRouterSettingSerialize(const json::Node& router_set
     return result;
 }
 
-serialize::Graph GetGraphSerialize(const graph::DirectedWeightedGraph<double>& g) {
+serialize::Edge Serialize(const graph::Edge<double>& edge, const NameIds& ids) {
+    serialize::Edge result;
+    result.set_name_id(ids.at(edge.name));
+    result.set_quality(edge.quality);
+    result.set_from(edge.from);
+    result.set_to(edge.to);
+    result.set_weight(edge.weight);
+    return result;
+}
+
+serialize::Vertex GetVertexSerialize(const graph::DirectedWeightedGraph<double>& g, graph::VertexId vertex_id) {
+    serialize::Vertex result;
+    for (const auto& edge_id : g.GetIncidentEdges(vertex_id)) {
+        result.add_edge_id(edge_id);
+    }
+    return result;
+}
+
+serialize::Graph GetGraphSerialize(const graph::DirectedWeightedGraph<double>& g, const NameIds& ids) {
     serialize::Graph result;
     size_t vertex_count = g.GetVertexCount();
     size_t edge_count = g.GetEdgeCount();
     for (size_t i = 0; i < edge_count; ++i) {
-        const graph::Edge<double>& edge = g.GetEdge(i);
-        serialize::Edge s_edge;
-        s_edge.set_name(edge.name);
-        s_edge.set_quality(edge.quality);
-        s_edge.set_from(edge.from);
-        s_edge.set_to(edge.to);
-        s_edge.set_weight(edge.weight);
-        *result.add_edge() = s_edge;
+        *result.add_edge() = Serialize(g.GetEdge(i), ids);
     }
     for (size_t i = 0; i < vertex_count; ++i) {
-        serialize::Vertex vertex;
-        for (const auto& edge_id : g.GetIncidentEdges(i)) {
-            vertex.add_edge_id(edge_id);
-        }
-        *result.add_vertex() = vertex;
+        *result.add_vertex() = GetVertexSerialize(g, i);
     }
     return result;
 }
 
-serialize::Router Serialize(const tc::Router& router) {
+serialize::Router Serialize(const tc::Router& router, const NameIds& ids) {
     serialize::Router result;
     *result.mutable_router_settings() = GetRouterSettingSerialize(router.GetSettings());
-    *result.mutable_graph() = GetGraphSerialize(router.GetGraph());
+    *result.mutable_graph() = GetGraphSerialize(router.GetGraph(), ids);
     for (const auto& [n, id] : router.GetStopIds()) {
         serialize::StopId si;
-        si.set_name(n);
+        si.set_name_id(ids.at(n));
         si.set_id(id);
         *result.add_stop_id() = si;
     }
     return result;
 }
 
+serialize::MapText Serialize(const renderer::MapText& map) {
+    serialize::MapText result;
+    result.set_svg(string(map.svg));
+    result.set_escaped(string(map.escaped));
+    return result;
+}
+
+tc::NameIndex GetNameIndexFromDB(const serialize::NameIndex& index) {
+    return tc::NameIndex(index.salt(),
+        { index.displacement().begin(), index.displacement().end() },
+        { index.slot().begin(), index.slot().end() },
+        { index.sorted_order().begin(), index.sorted_order().end() });
+}
+
+void SetStopGridFromDB(tc::Catalogue& tcat, const serialize::SpatialIndex& grid) {
+    tc::SpatialIndex::Layout layout;
+    layout.min = { grid.min_lat(), grid.min_lng() };
+    layout.max = { grid.max_lat(), grid.max_lng() };
+    layout.rows = grid.rows();
+    layout.cols = grid.cols();
+    std::vector<geo::Coordinates> points;
+    points.reserve(tcat.GetAllStops().size());
+    for (const auto& stop : tcat.GetAllStops()) {
+        points.push_back(stop->coordinates);
+    }
+    tcat.SetStopGrid(tc::SpatialIndex(layout,
+        { grid.cell_start().begin(), grid.cell_start().end() },
+        { grid.item().begin(), grid.item().end() }, points));
+}
+
+bool HasStringTable(const serialize::TransportCatalogue& database) {
+    return database.version() >= 2;
+}
+
+const string& GetNameFromDB(const serialize::TransportCatalogue& database, uint32_t id) {
+    return database.string_table().at(id);
+}
+
 void SetStopsDistances(tc::Catalogue& tcat, const serialize::TransportCatalogue& database) {
-    for (size_t i = 0; i < database.stop_size(); ++i) {
+    const auto& all_stops = tcat.GetAllStops();
+    for (int i = 0; i < database.stop_size(); ++i) {
         const serialize::Stop& stop_i = database.stop(i);
+        if (HasStringTable(database)) {
+            for (int j = 0; j < stop_i.near_stop_id_size(); ++j) {
+                tcat.SetDistance(all_stops[i].get(), all_stops.at(stop_i.near_stop_id(j)).get(), stop_i.distance(j));
+            }
+            continue;
+        }
         tc::Stop* from = tcat.FindStop(stop_i.name());
-        for (size_t j = 0; j < stop_i.near_stop_size(); ++j) {
+        for (int j = 0; j < stop_i.near_stop_size(); ++j) {
             tcat.SetDistance(from, tcat.FindStop(stop_i.near_stop(j)), stop_i.distance(j));
         }
     }
 }
 
 void AddStopFromDB(tc::Catalogue& tcat, const serialize::TransportCatalogue& database) {
-    for (size_t i = 0; i < database.stop_size(); ++i) {
+    for (int i = 0; i < database.stop_size(); ++i) {
         const serialize::Stop& stop_i = database.stop(i);
-        tcat.AddStop(stop_i.name(), { stop_i.coordinate(0), stop_i.coordinate(1) });
+        const string& name = HasStringTable(database) ? GetNameFromDB(database, stop_i.name_id()) : stop_i.name();
+        tcat.AddStop(name, { stop_i.coordinate(0), stop_i.coordinate(1) });
+    }
+    // В старых базах индекса нет — тогда каталог построит его сам при первом поиске
+    if (database.has_stop_index()) {
+        tcat.SetStopIndex(GetNameIndexFromDB(database.stop_index()));
+    }
+    if (database.has_stop_grid()) {
+        SetStopGridFromDB(tcat, database.stop_grid());
     }
     SetStopsDistances(tcat, database);
 }
 
 void AddBusFromDB(tc::Catalogue& tcat, const serialize::TransportCatalogue& database) {
-    for (size_t i = 0; i < database.bus_size(); ++i) {
+    const auto& all_stops = tcat.GetAllStops();
+    for (int i = 0; i < database.bus_size(); ++i) {
         const serialize::Bus& bus_i = database.bus(i);
+        if (HasStringTable(database)) {
+            std::vector<tc::Stop*> stops(bus_i.stop_id_size());
+            for (size_t j = 0; j < stops.size(); ++j) {
+                stops[j] = all_stops.at(bus_i.stop_id(j)).get();
+            }
+            tcat.AddBus(GetNameFromDB(database, bus_i.name_id()), stops, bus_i.is_circle());
+            continue;
+        }
         std::vector<tc::Stop*> stops(bus_i.stop_size());
         for (size_t j = 0; j < stops.size(); ++j) {
             stops[j] = tcat.FindStop(bus_i.stop(j));
         }
         tcat.AddBus(bus_i.name(), stops, bus_i.is_circle());
-        if (!bus_i.final_stop().empty()) {
-            tc::Bus* bus = tcat.FindBus(bus_i.name());
-            bus->final_stop = tcat.FindStop(bus_i.final_stop());
+    }
+    if (database.has_bus_index()) {
+        tcat.SetBusIndex(GetNameIndexFromDB(database.bus_index()));
+    }
+    const auto& all_buses = tcat.GetAllBuses();
+    for (int i = 0; i < database.bus_size(); ++i) {
+        const serialize::Bus& bus_i = database.bus(i);
+        if (HasStringTable(database)) {
+            if (bus_i.final_stop_id() > 0) {
+                tcat.SetFinalStop(all_buses[i].get(), all_stops.at(bus_i.final_stop_id() - 1).get());
+            }
+        }
+        else if (!bus_i.final_stop().empty()) {
+            tcat.SetFinalStop(tcat.FindBus(bus_i.name()), tcat.FindStop(bus_i.final_stop()));
         }
     }
 }
@@ -201,8 +341,7 @@ json::Node ToNode(const google::protobuf::RepeatedPtrField<serialize::Color>& cv
     return json::Node(std::move(result));
 }
 
-json::Node GetRenderSettingsFromDB(const serialize::TransportCatalogue& database) {
-    const serialize::RenderSettings& rs = database.render_settings();
+json::Node GetRenderSettingsFromDB(const serialize::RenderSettings& rs) {
     return json::Node(json::Dict{
                     {{"width"s},{ rs.width() }},
                     {{"height"s},{ rs.height() }},
@@ -219,52 +358,184 @@ json::Node GetRenderSettingsFromDB(const serialize::TransportCatalogue& database
         });
 }
 
-json::Node GetRouterSettingsFromDB(const serialize::Router& router) {
-    const serialize::RouterSettings& rs = router.router_settings();
+json::Node GetRouterSettingsFromDB(const serialize::RouterSettings& rs) {
     return json::Node(json::Dict{
                     {{"bus_wait_time"s},{ rs.bus_wait_time() }},
                     {{"bus_velocity"s},{ rs.bus_velocity() }}
         });
 }
 
-graph::DirectedWeightedGraph<double> GetGraphFromDB(const serialize::Router& router) {
-    const serialize::Graph& g = router.graph();
+renderer::MapText GetMapTextFromDB(const serialize::MapText& map) {
+    return renderer::MakeMapText(map.svg(), map.escaped());
+}
+
+graph::DirectedWeightedGraph<double> GetGraphFromDB(const serialize::TransportCatalogue& database, ThreadPool& pool) {
+    const serialize::Graph& g = database.router().graph();
     std::vector<graph::Edge<double>> edges(g.edge_size());
     std::vector<std::vector<graph::EdgeId>> incidence_lists(g.vertex_size());
-    for (size_t i = 0; i < edges.size(); ++i) {
-        const serialize::Edge& e = g.edge(i);
-        edges[i] = { e.name(), static_cast<size_t>(e.quality()),
-        static_cast<size_t>(e.from()), static_cast<size_t>(e.to()), e.weight() };
-    }
-    for (size_t i = 0; i < incidence_lists.size(); ++i) {
-        const serialize::Vertex& v = g.vertex(i);
-        incidence_lists[i].reserve(v.edge_id_size());
-        for (const auto& id : v.edge_id()) {
-            incidence_lists[i].push_back(id);
+    // Рёбер в базе больше всего, поэтому они разбираются кусками параллельно
+    pool.ParallelFor(edges.size(), GRAPH_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const serialize::Edge& e = g.edge(i);
+            const string& name = HasStringTable(database) ? GetNameFromDB(database, e.name_id()) : e.name();
+            edges[i] = { name, static_cast<size_t>(e.quality()),
+            static_cast<size_t>(e.from()), static_cast<size_t>(e.to()), e.weight() };
         }
-    }
+        });
+    pool.ParallelFor(incidence_lists.size(), GRAPH_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const serialize::Vertex& v = g.vertex(i);
+            incidence_lists[i].assign(v.edge_id().begin(), v.edge_id().end());
+        }
+        });
     return graph::DirectedWeightedGraph<double>(edges, incidence_lists);
 }
 
-std::map<std::string, graph::VertexId> GetStopIdsFromDB(const serialize::Router& router) {
-    std::map<std::string, graph::VertexId> result;
-    for (const auto& s : router.stop_id()) {
-        result[s.name()] = s.id();
+tc::StopIds GetStopIdsFromDB(const serialize::TransportCatalogue& database) {
+    tc::StopIds result;
+    for (const auto& s : database.router().stop_id()) {
+        result[HasStringTable(database) ? GetNameFromDB(database, s.name_id()) : s.name()] = s.id();
     }
     return result;
 }
 
-std::tuple<tc::Catalogue, renderer::MapRenderer, tc::Router,
-    graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>>
-    Deserialize(std::istream& input) {
+Base Deserialize(std::istream& input) {
     serialize::TransportCatalogue database;
     database.ParseFromIstream(&input);
-    tc::Catalogue tcat;
-    renderer::MapRenderer renderer(GetRenderSettingsFromDB(database));
-    tc::Router router(GetRouterSettingsFromDB(database.router()));
-    AddStopFromDB(tcat, database);
-    AddBusFromDB(tcat, database);
-    return { std::move(tcat), std::move(renderer), std::move(router),
-                            GetGraphFromDB(database.router()),
-                            GetStopIdsFromDB(database.router()) };
+    // Граф и номера вершин от каталога не зависят и разбираются в пуле, пока строится каталог
+    ThreadPool& pool = ThreadPool::GetShared();
+    auto graph = pool.Submit([&database, &pool] { return GetGraphFromDB(database, pool); });
+    auto stop_ids = pool.Submit([&database] { return GetStopIdsFromDB(database); });
+    try {
+        tc::Catalogue tcat;
+        renderer::MapRenderer renderer(GetRenderSettingsFromDB(database.render_settings()));
+        tc::Router router(GetRouterSettingsFromDB(database.router().router_settings()));
+        AddStopFromDB(tcat, database);
+        AddBusFromDB(tcat, database);
+        if (database.has_name_prefixes()) {
+            const serialize::PrefixIndex& prefixes = database.name_prefixes();
+            tcat.SetNamePrefixes(tc::PrefixIndex(prefixes.data(),
+                { prefixes.block_offset().begin(), prefixes.block_offset().end() }, prefixes.size()));
+        }
+        optional<renderer::MapText> map;
+        if (database.has_map()) {
+            map = GetMapTextFromDB(database.map());
+        }
+        return { std::move(tcat), std::move(renderer), std::move(router), graph.get(), stop_ids.get(), std::move(map) };
+    }
+    catch (...) {
+        // Задачи читают database, поэтому ей нельзя разрушаться раньше них
+        graph.wait();
+        stop_ids.wait();
+        throw;
+    }
+}
+
+BaseFormat GetBaseFormat(const json::Node& serialization_settings) {
+    const json::Dict& settings = serialization_settings.AsDict();
+    const auto it = settings.find("format"s);
+    if (it == settings.end() || it->second.AsString() == "protobuf"s) {
+        return BaseFormat::PROTOBUF;
+    }
+    if (it->second.AsString() == "flat"s) {
+        return BaseFormat::FLAT;
+    }
+    if (it->second.AsString() == "compressed"s) {
+        return BaseFormat::COMPRESSED;
+    }
+    if (it->second.AsString() == "stream"s) {
+        return BaseFormat::STREAM;
+    }
+    throw invalid_argument("Unknown base format: "s + string(it->second.AsString()));
+}
+
+bool GetPrerenderMap(const json::Node& serialization_settings) {
+    const json::Dict& settings = serialization_settings.AsDict();
+    const auto it = settings.find("prerender_map"s);
+    return it != settings.end() && it->second.AsBool();
+}
+
+optional<BaseFormat> DetectBaseFormat(const string& path) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        return nullopt;
+    }
+    if (flat::IsFlatBase(input)) {
+        return BaseFormat::FLAT;
+    }
+    if (compressed::IsCompressedBase(input)) {
+        return BaseFormat::COMPRESSED;
+    }
+    if (stream::IsStreamBase(input)) {
+        return BaseFormat::STREAM;
+    }
+    return BaseFormat::PROTOBUF;
+}
+
+void SaveBase(const string& path, BaseFormat format, const tc::Catalogue& tcat,
+    const renderer::MapRenderer& renderer, const tc::Router& router, bool prerender_map) {
+    optional<renderer::MapText> map;
+    if (prerender_map) {
+        map = renderer.RenderText(tcat.GetSortedAllBuses());
+    }
+    ofstream output(path, ios::binary);
+    if (!output.is_open()) {
+        throw runtime_error("Cannot write "s + path);
+    }
+    if (format == BaseFormat::FLAT) {
+        flat::Serialize(tcat, renderer, router, map, output);
+    }
+    else if (format == BaseFormat::COMPRESSED) {
+        compressed::Serialize(tcat, renderer, router, map, output);
+    }
+    else if (format == BaseFormat::STREAM) {
+        stream::Serialize(tcat, renderer, router, map, output);
+    }
+    else {
+        Serialize(tcat, renderer, router, map, output);
+    }
+    output.close();
+    if (!output) {
+        throw runtime_error("Cannot write "s + path);
+    }
+}
+
+optional<Base> LoadBase(const string& path) {
+    const optional<BaseFormat> format = DetectBaseFormat(path);
+    if (!format) {
+        return nullopt;
+    }
+    if (*format == BaseFormat::FLAT) {
+        return flat::Deserialize(make_shared<const MappedFile>(path));
+    }
+    ifstream input(path, ios::binary);
+    if (*format == BaseFormat::COMPRESSED) {
+        return compressed::Deserialize(input);
+    }
+    if (*format == BaseFormat::STREAM) {
+        return stream::Deserialize(input);
+    }
+    return Deserialize(input);
+}
+
+optional<LoadedBase> OpenBase(const string& path) {
+    const optional<BaseFormat> format = DetectBaseFormat(path);
+    if (!format) {
+        return nullopt;
+    }
+    if (*format == BaseFormat::FLAT) {
+        return flat::Open(make_shared<const MappedFile>(path));
+    }
+    optional<Base> base = LoadBase(path);
+    auto& [tcat, renderer, router, graph, stop_ids, map] = *base;
+    using RouterData = pair<graph::DirectedWeightedGraph<double>, tc::StopIds>;
+    auto router_data = make_shared<RouterData>(move(graph), move(stop_ids));
+    return LoadedBase{ move(tcat),
+        Lazy<tc::Router>([settings = router.GetSettings(), router_data] {
+            auto result = make_unique<tc::Router>(settings);
+            result->SetGraph(move(router_data->first), move(router_data->second));
+            return result;
+            }),
+        Lazy<renderer::MapRenderer>(make_unique<renderer::MapRenderer>(move(renderer))),
+        Lazy<optional<renderer::MapText>>(make_unique<optional<renderer::MapText>>(move(map))) };
 }
\ No newline at end of file
@@ -7,23 +7,100 @@
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
+#include "lazy.h"
+#include "thread_pool.h"
 
 #include <transport_catalogue.pb.h>
 
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <string_view>
+
+// Номера имён в string_table базы
+using NameIds = std::unordered_map<std::string_view, uint32_t>;
+
+// Последний элемент — карта, сохранённая при make_base, если её просили
+using Base = std::tuple<tc::Catalogue, renderer::MapRenderer, tc::Router,
+    graph::DirectedWeightedGraph<double>, tc::StopIds, std::optional<renderer::MapText>>;
+
+enum class BaseFormat {
+    PROTOBUF,
+    // Выровненные секции в отображённом в память файле; на месте читаются только строки
+    FLAT,
+    // Квантованные и разностно закодированные столбцы, сжатые zlib
+    COMPRESSED,
+    // Последовательность небольших записей: пишется и читается с ограниченной памятью
+    STREAM
+};
+
+// Формат из serialization_settings["format"], по умолчанию protobuf
+BaseFormat GetBaseFormat(const json::Node& serialization_settings);
+
+// serialization_settings["prerender_map"]: сохранить в базе готовую карту, по умолчанию нет
+bool GetPrerenderMap(const json::Node& serialization_settings);
+
+// Формат существующей базы по её заголовку; nullopt, если файл не открывается
+std::optional<BaseFormat> DetectBaseFormat(const std::string& path);
+
+// С prerender_map карта рисуется сразу и пишется в базу, чтобы запросам Map не нужен был отрисовщик
+void SaveBase(const std::string& path, BaseFormat format, const tc::Catalogue& tcat,
+    const renderer::MapRenderer& renderer, const tc::Router& router, bool prerender_map = false);
+
+// Читает базу любого формата; nullopt, если файла нет
+std::optional<Base> LoadBase(const std::string& path);
+
+// База для обработки запросов: каталог читается сразу, а маршрутизатор (вместе
+// с предрасчётом маршрутов) и отрисовщик — при первом обращении
+struct LoadedBase {
+    tc::Catalogue catalogue;
+    Lazy<tc::Router> router;
+    Lazy<renderer::MapRenderer> renderer;
+    // Пусто, если база сохранена без карты
+    Lazy<std::optional<renderer::MapText>> map;
+};
+
+// Плоская база читается по секциям через каталог секций; остальные форматы
+// разбираются целиком, но маршрутизатор всё равно строится лениво
+std::optional<LoadedBase> OpenBase(const std::string& path);
+
 void Serialize(const tc::Catalogue& tcat,
     const renderer::MapRenderer& renderer,
     const tc::Router& router,
+    const std::optional<renderer::MapText>& map,
     std::ostream& output);
 
-serialize::Stop Serialize(const tc::Stop* stop);
+serialize::Stop Serialize(const tc::Stop* stop, const NameIds& ids);
 
-serialize::Bus Serialize(const tc::Bus* bus);
+serialize::Bus Serialize(const tc::Bus* bus, const NameIds& ids);
+
+serialize::NameIndex Serialize(const tc::NameIndex& index);
+
+serialize::SpatialIndex Serialize(const tc::SpatialIndex& grid);
+
+serialize::PrefixIndex Serialize(const tc::PrefixIndex& prefixes);
+
+serialize::Edge Serialize(const graph::Edge<double>& edge, const NameIds& ids);
+
+serialize::Vertex GetVertexSerialize(const graph::DirectedWeightedGraph<double>& g, graph::VertexId vertex_id);
 
 serialize::RenderSettings GetRenderSettingSerialize(const json::Node& render_settings);
 
 serialize::RouterSettings GetRouterSettingSerialize(const json::Node& router_settings);
 
-serialize::Router Serialize(const tc::Router& router);
+serialize::Router Serialize(const tc::Router& router, const NameIds& ids);
+
+serialize::MapText Serialize(const renderer::MapText& map);
+
+tc::NameIndex GetNameIndexFromDB(const serialize::NameIndex& index);
+
+// Остановки каталога уже должны быть добавлены
+void SetStopGridFromDB(tc::Catalogue& tcat, const serialize::SpatialIndex& grid);
+
+json::Node GetRenderSettingsFromDB(const serialize::RenderSettings& render_settings);
+
+json::Node GetRouterSettingsFromDB(const serialize::RouterSettings& router_settings);
+
+renderer::MapText GetMapTextFromDB(const serialize::MapText& map);
 
-std::tuple<tc::Catalogue, renderer::MapRenderer, tc::Router,
-    graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>> Deserialize(std::istream& input);
\ No newline at end of file
+Base Deserialize(std::istream& input);
\ No newline at end of file
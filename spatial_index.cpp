@@ -0,0 +1,188 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace tc {
+
+    namespace {
+        using namespace std::literals;
+
+        // Среднее количество точек в ячейке
+        const double POINTS_PER_CELL = 2.0;
+        // Минимальный размер ячейки в градусах, чтобы вырожденная сетка не делила на ноль
+        const double MIN_EXTENT = 1e-9;
+
+        const double DEG_TO_RAD = M_PI / 180.0;
+        const double INF = std::numeric_limits<double>::infinity();
+
+        // Нижняя оценка расстояния до точек, отстоящих по широте не меньше чем на lat_gap
+        // и по долготе не меньше чем на lng_gap градусов
+        double LowerBound(geo::Coordinates from, double lat_gap, double lng_gap) {
+            double result = INF;
+            if (lat_gap < INF) {
+                result = std::max(0.0, lat_gap) * DEG_TO_RAD * geo::EARTH_RADIUS;
+            }
+            if (lng_gap < INF) {
+                const double lng_rad = std::min(std::max(0.0, lng_gap), 90.0) * DEG_TO_RAD;
+                const double meridian = std::asin(std::min(1.0, std::cos(from.lat * DEG_TO_RAD) * std::sin(lng_rad)));
+                result = std::min(result, meridian * geo::EARTH_RADIUS);
+            }
+            return result;
+        }
+
+        double Distance(geo::Coordinates from, geo::Coordinates to) {
+            const double result = geo::ComputeDistance(from, to);
+            // acos от округлённой единицы у совпадающих точек даёт NaN
+            return std::isnan(result) ? 0.0 : result;
+        }
+    }
+
+    SpatialIndex::SpatialIndex(const std::vector<geo::Coordinates>& points) {
+        if (points.empty()) return;
+        const auto [min_lat, max_lat] = std::minmax_element(points.begin(), points.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.lat < rhs.lat; });
+        const auto [min_lng, max_lng] = std::minmax_element(points.begin(), points.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.lng < rhs.lng; });
+        layout_.min = { min_lat->lat, min_lng->lng };
+        layout_.max = { max_lat->lat, max_lng->lng };
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(points.size() / POINTS_PER_CELL)));
+        layout_.rows = std::max(1u, side);
+        layout_.cols = std::max(1u, side);
+
+        std::vector<uint32_t> cells(points.size());
+        cell_start_.assign(static_cast<size_t>(layout_.rows) * layout_.cols + 1, 0);
+        for (size_t i = 0; i < points.size(); ++i) {
+            cells[i] = GetRow(points[i].lat) * layout_.cols + GetCol(points[i].lng);
+            ++cell_start_[cells[i] + 1];
+        }
+        for (size_t i = 1; i < cell_start_.size(); ++i) {
+            cell_start_[i] += cell_start_[i - 1];
+        }
+        items_.resize(points.size());
+        points_.resize(points.size());
+        std::vector<uint32_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+        for (uint32_t i = 0; i < points.size(); ++i) {
+            const uint32_t pos = fill[cells[i]]++;
+            items_[pos] = i;
+            points_[pos] = points[i];
+        }
+    }
+
+    SpatialIndex::SpatialIndex(const Layout& layout, std::vector<uint32_t> cell_start,
+        std::vector<uint32_t> items, const std::vector<geo::Coordinates>& points)
+        : layout_(layout)
+        , cell_start_(std::move(cell_start))
+        , items_(std::move(items))
+    {
+        const size_t cell_count = static_cast<size_t>(layout_.rows) * layout_.cols;
+        if (items_.size() != points.size()
+            || (!items_.empty() && (cell_start_.size() != cell_count + 1 || cell_start_.back() != items_.size()))) {
+            throw std::invalid_argument("Inconsistent spatial index"s);
+        }
+        points_.reserve(items_.size());
+        for (const uint32_t i : items_) {
+            points_.push_back(points.at(i));
+        }
+    }
+
+    std::vector<std::pair<uint32_t, double>> SpatialIndex::FindNearest(geo::Coordinates from, size_t count) const {
+        std::vector<std::pair<uint32_t, double>> result;
+        if (items_.empty() || count == 0) return result;
+
+        // Наибольшее из найденных расстояний лежит на вершине кучи
+        const auto farther = [](const auto& lhs, const auto& rhs) {
+            return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+        };
+        std::priority_queue<std::pair<uint32_t, double>, std::vector<std::pair<uint32_t, double>>, decltype(farther)> best(farther);
+
+        const int rows = static_cast<int>(layout_.rows);
+        const int cols = static_cast<int>(layout_.cols);
+        const int from_row = static_cast<int>(GetRow(from.lat));
+        const int from_col = static_cast<int>(GetCol(from.lng));
+        const auto visit = [this, &best, from, count, farther](int row, int col) {
+            const size_t cell = static_cast<size_t>(row) * layout_.cols + col;
+            for (uint32_t pos = cell_start_[cell]; pos < cell_start_[cell + 1]; ++pos) {
+                std::pair<uint32_t, double> candidate{ items_[pos], Distance(from, points_[pos]) };
+                if (best.size() < count) {
+                    best.push(candidate);
+                }
+                else if (farther(candidate, best.top())) {
+                    best.pop();
+                    best.push(candidate);
+                }
+            }
+        };
+
+        // Обходим кольца ячеек вокруг ячейки запроса, пока следующее кольцо может что-то улучшить
+        for (int ring = 0;; ++ring) {
+            const int top = from_row - ring;
+            const int bottom = from_row + ring;
+            const int left = from_col - ring;
+            const int right = from_col + ring;
+            for (int row = std::max(top, 0); row <= std::min(bottom, rows - 1); ++row) {
+                const bool edge_row = row == top || row == bottom;
+                for (int col = std::max(left, 0); col <= std::min(right, cols - 1); ++col) {
+                    if (edge_row || col == left || col == right) {
+                        visit(row, col);
+                    }
+                }
+            }
+            if (top <= 0 && bottom >= rows - 1 && left <= 0 && right >= cols - 1) break;
+
+            const double lat_gap = std::min(
+                top > 0 ? from.lat - (layout_.min.lat + top * GetCellHeight()) : INF,
+                bottom < rows - 1 ? layout_.min.lat + (bottom + 1) * GetCellHeight() - from.lat : INF);
+            const double lng_gap = std::min(
+                left > 0 ? from.lng - (layout_.min.lng + left * GetCellWidth()) : INF,
+                right < cols - 1 ? layout_.min.lng + (right + 1) * GetCellWidth() - from.lng : INF);
+            if (best.size() == count && best.top().second <= LowerBound(from, lat_gap, lng_gap)) break;
+        }
+
+        result.resize(best.size());
+        for (auto it = result.rbegin(); it != result.rend(); ++it) {
+            *it = best.top();
+            best.pop();
+        }
+        return result;
+    }
+
+    size_t SpatialIndex::Size() const {
+        return items_.size();
+    }
+
+    const SpatialIndex::Layout& SpatialIndex::GetLayout() const {
+        return layout_;
+    }
+
+    const std::vector<uint32_t>& SpatialIndex::GetCellStart() const {
+        return cell_start_;
+    }
+
+    const std::vector<uint32_t>& SpatialIndex::GetItems() const {
+        return items_;
+    }
+
+    uint32_t SpatialIndex::GetRow(double lat) const {
+        const double row = std::floor((lat - layout_.min.lat) / GetCellHeight());
+        return static_cast<uint32_t>(std::clamp(row, 0.0, layout_.rows - 1.0));
+    }
+
+    uint32_t SpatialIndex::GetCol(double lng) const {
+        const double col = std::floor((lng - layout_.min.lng) / GetCellWidth());
+        return static_cast<uint32_t>(std::clamp(col, 0.0, layout_.cols - 1.0));
+    }
+
+    double SpatialIndex::GetCellHeight() const {
+        return std::max(layout_.max.lat - layout_.min.lat, MIN_EXTENT) / layout_.rows;
+    }
+
+    double SpatialIndex::GetCellWidth() const {
+        return std::max(layout_.max.lng - layout_.min.lng, MIN_EXTENT) / layout_.cols;
+    }
+
+} // namespace tc
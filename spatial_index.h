@@ -0,0 +1,56 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tc {
+
+    // Равномерная сетка над координатами точек. Ячейки хранятся подряд (CSR):
+    // номера точек ячейки i лежат в items_[cell_start_[i] .. cell_start_[i + 1])
+    class SpatialIndex {
+    public:
+        struct Layout {
+            geo::Coordinates min = { 0.0, 0.0 };
+            geo::Coordinates max = { 0.0, 0.0 };
+            uint32_t rows = 0;
+            uint32_t cols = 0;
+        };
+
+        SpatialIndex() = default;
+
+        // Позиция точки в векторе считается её порядковым номером
+        explicit SpatialIndex(const std::vector<geo::Coordinates>& points);
+
+        // Восстанавливает сетку из базы; points — координаты точек по порядковым номерам
+        SpatialIndex(const Layout& layout, std::vector<uint32_t> cell_start,
+            std::vector<uint32_t> items, const std::vector<geo::Coordinates>& points);
+
+        // До count ближайших точек: порядковый номер и расстояние в метрах, по возрастанию расстояния
+        std::vector<std::pair<uint32_t, double>> FindNearest(geo::Coordinates from, size_t count) const;
+
+        size_t Size() const;
+
+        const Layout& GetLayout() const;
+
+        const std::vector<uint32_t>& GetCellStart() const;
+
+        const std::vector<uint32_t>& GetItems() const;
+
+    private:
+        Layout layout_;
+        std::vector<uint32_t> cell_start_;
+        std::vector<uint32_t> items_;
+        // Координаты в порядке items_, чтобы перебор ячейки шёл по соседним адресам
+        std::vector<geo::Coordinates> points_;
+
+        uint32_t GetRow(double lat) const;
+        uint32_t GetCol(double lng) const;
+        double GetCellHeight() const;
+        double GetCellWidth() const;
+    };
+
+} // namespace tc
@@ -0,0 +1,115 @@
+#include "stat_protocol.h"
+
+#include <stdexcept>
+
+namespace protocol {
+
+    namespace {
+        using namespace std::literals;
+
+        const size_t FLUSH_SIZE = 64 * 1024;
+
+        // Ключ поля ResponseBatch.responses: номер поля и тип «данные с длиной»
+        const uint32_t RESPONSES_TAG = (ResponseBatch::kResponsesFieldNumber << 3) | 2;
+
+        void AppendVarint(std::string& buffer, uint64_t value) {
+            while (value >= 0x80) {
+                buffer.push_back(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+    }
+
+    RequestBatch ReadRequests(std::istream& input) {
+        RequestBatch batch;
+        if (!batch.ParseFromIstream(&input)) {
+            throw std::runtime_error("Malformed request batch"s);
+        }
+        return batch;
+    }
+
+    RequestBatch ReadRequests(std::string_view data) {
+        RequestBatch batch;
+        if (!batch.ParseFromArray(data.data(), static_cast<int>(data.size()))) {
+            throw std::runtime_error("Malformed request batch"s);
+        }
+        return batch;
+    }
+
+    std::vector<requests::StatRequest> Decode(const RequestBatch& batch, const tc::Catalogue& db) {
+        std::vector<requests::StatRequest> result;
+        result.reserve(batch.stat_requests_size());
+        for (const StatRequest& request : batch.stat_requests()) {
+            switch (request.query_case()) {
+            case StatRequest::kStop:
+                result.push_back({ request.id(), requests::StopRequest{ db.FindStop(request.stop().name()) } });
+                break;
+            case StatRequest::kBus:
+                result.push_back({ request.id(), requests::BusRequest{ db.FindBus(request.bus().name()) } });
+                break;
+            case StatRequest::kRoute:
+                result.push_back({ request.id(), requests::RouteRequest{
+                    db.FindStop(request.route().from()), db.FindStop(request.route().to()) } });
+                break;
+            case StatRequest::kMap:
+                result.push_back({ request.id(), requests::MapRequest{} });
+                break;
+            case StatRequest::QUERY_NOT_SET:
+                // Запросы неизвестных типов пропускаются, как и в JSON
+                break;
+            }
+        }
+        return result;
+    }
+
+    ResponseWriter::ResponseWriter(std::ostream& output, bool with_names)
+        : output_(output)
+        , with_names_(with_names) {
+    }
+
+    void ResponseWriter::Add(const StatResponse& response) {
+        if (with_names_) {
+            for (const uint32_t id : response.stop().bus_id()) {
+                bus_ids_.insert(id);
+            }
+            for (const RouteItem& item : response.route().item()) {
+                if (item.has_wait_stop_id()) {
+                    stop_ids_.insert(item.wait_stop_id());
+                }
+                else {
+                    bus_ids_.insert(item.bus_id());
+                }
+            }
+        }
+        const size_t size = response.ByteSizeLong();
+        AppendVarint(buffer_, RESPONSES_TAG);
+        AppendVarint(buffer_, size);
+        const size_t offset = buffer_.size();
+        buffer_.resize(offset + size);
+        response.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer_.data() + offset));
+        if (buffer_.size() >= FLUSH_SIZE) {
+            Flush();
+        }
+    }
+
+    void ResponseWriter::Finish(const tc::Catalogue& db) {
+        if (with_names_) {
+            ResponseBatch names;
+            for (const uint32_t id : stop_ids_) {
+                (*names.mutable_stop_names())[id] = std::string(db.GetAllStops().at(id)->name);
+            }
+            for (const uint32_t id : bus_ids_) {
+                (*names.mutable_bus_names())[id] = std::string(db.GetAllBuses().at(id)->name);
+            }
+            names.AppendToString(&buffer_);
+        }
+        Flush();
+    }
+
+    void ResponseWriter::Flush() {
+        output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+} // namespace protocol
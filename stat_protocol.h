@@ -0,0 +1,49 @@
+#pragma once
+
+#include "stat_requests.h"
+#include "transport_catalogue.h"
+
+#include <stat_protocol.pb.h>
+
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Двоичные запросы process_requests и ответы на них, см. stat_protocol.proto
+namespace protocol {
+
+    // Бросают std::runtime_error, если вход не является RequestBatch
+    RequestBatch ReadRequests(std::istream& input);
+
+    RequestBatch ReadRequests(std::string_view data);
+
+    // Приводит запросы к тому же виду, что и requests::Decode для JSON.
+    // Запросы действительны, пока живы версия каталога db и batch
+    std::vector<requests::StatRequest> Decode(const RequestBatch& batch, const tc::Catalogue& db);
+
+    // Выводит ответы по одному, каждый отдельным фрагментом ResponseBatch; текст копится
+    // в буфере и уходит в поток порциями. Если нужны имена, запоминает встреченные
+    // номера остановок и маршрутов, и Finish дописывает их таблицу
+    class ResponseWriter {
+    public:
+        ResponseWriter(std::ostream& output, bool with_names);
+
+        void Add(const StatResponse& response);
+
+        // Номера в ответах относятся к db
+        void Finish(const tc::Catalogue& db);
+
+    private:
+        std::ostream& output_;
+        bool with_names_;
+        std::string buffer_;
+        std::set<uint32_t> stop_ids_;
+        std::set<uint32_t> bus_ids_;
+
+        void Flush();
+    };
+
+} // namespace protocol
@@ -0,0 +1,109 @@
+#include "stat_requests.h"
+
+#include <array>
+#include <stdexcept>
+
+namespace requests {
+
+    namespace {
+        using namespace std::literals;
+
+        struct TypeName {
+            std::string_view name;
+            RequestType type;
+        };
+
+        constexpr std::array<TypeName, 6> TYPE_NAMES = { {
+            { "Stop"sv, RequestType::STOP },
+            { "Bus"sv, RequestType::BUS },
+            { "Map"sv, RequestType::MAP },
+            { "Route"sv, RequestType::ROUTE },
+            { "NearestStops"sv, RequestType::NEAREST_STOPS },
+            { "Suggest"sv, RequestType::SUGGEST },
+        } };
+
+        constexpr size_t TYPE_SLOTS = 8;
+
+        // Совершенная для TYPE_NAMES хеш-функция: по первому символу и длине имени
+        constexpr size_t TypeSlot(std::string_view name) {
+            return (static_cast<unsigned char>(name.front()) * 3 + name.size()) % TYPE_SLOTS;
+        }
+
+        // Номер имени в TYPE_NAMES для каждой ячейки, -1 — пустая ячейка.
+        // При совпадении ячеек таблица перестаёт быть константой, и сборка прерывается
+        constexpr std::array<int, TYPE_SLOTS> MakeTypeTable() {
+            std::array<int, TYPE_SLOTS> table = {};
+            for (size_t slot = 0; slot < TYPE_SLOTS; ++slot) {
+                table[slot] = -1;
+            }
+            for (size_t i = 0; i < TYPE_NAMES.size(); ++i) {
+                const size_t slot = TypeSlot(TYPE_NAMES[i].name);
+                if (table[slot] != -1) {
+                    throw std::logic_error("Request type hash collision");
+                }
+                table[slot] = static_cast<int>(i);
+            }
+            return table;
+        }
+
+        constexpr std::array<int, TYPE_SLOTS> TYPE_TABLE = MakeTypeTable();
+
+        size_t ToCount(int count) {
+            return count > 0 ? static_cast<size_t>(count) : 0;
+        }
+
+        Query DecodeQuery(RequestType type, const json::Dict& request, const tc::Catalogue& db) {
+            switch (type) {
+            case RequestType::STOP:
+                return StopRequest{ db.FindStop(request.at("name"sv).AsString()) };
+            case RequestType::BUS:
+                return BusRequest{ db.FindBus(request.at("name"sv).AsString()) };
+            case RequestType::MAP:
+                return MapRequest{};
+            case RequestType::ROUTE: {
+                const tc::Stop* from = db.FindStop(request.at("from"sv).AsString());
+                const tc::Stop* to = db.FindStop(request.at("to"sv).AsString());
+                return RouteRequest{ from, to };
+            }
+            case RequestType::NEAREST_STOPS: {
+                const geo::Coordinates from{ request.at("latitude"sv).AsDouble(),
+                                             request.at("longitude"sv).AsDouble() };
+                return NearestStopsRequest{ from, ToCount(request.at("count"sv).AsInt()) };
+            }
+            case RequestType::SUGGEST: {
+                const std::string_view prefix = request.at("prefix"sv).AsString();
+                return SuggestRequest{ prefix, ToCount(request.at("count"sv).AsInt()) };
+            }
+            }
+            throw std::logic_error("Unknown request type"s);
+        }
+    }
+
+    std::optional<RequestType> ParseRequestType(std::string_view name) {
+        if (name.empty()) {
+            return std::nullopt;
+        }
+        const int index = TYPE_TABLE[TypeSlot(name)];
+        if (index == -1 || TYPE_NAMES[index].name != name) {
+            return std::nullopt;
+        }
+        return TYPE_NAMES[index].type;
+    }
+
+    std::vector<StatRequest> Decode(const json::Node& stat_requests, const tc::Catalogue& db) {
+        const json::Array& arr = stat_requests.AsArray();
+        std::vector<StatRequest> result;
+        result.reserve(arr.size());
+        for (const json::Node& node : arr) {
+            const json::Dict& request = node.AsDict();
+            const std::optional<RequestType> type = ParseRequestType(request.at("type"sv).AsString());
+            if (!type) {
+                continue;
+            }
+            const int id = request.at("id"sv).AsInt();
+            result.push_back({ id, DecodeQuery(*type, request, db) });
+        }
+        return result;
+    }
+
+} // namespace requests
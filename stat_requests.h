@@ -0,0 +1,70 @@
+#pragma once
+
+#include "geo.h"
+#include "json.h"
+#include "transport_catalogue.h"
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Запросы stat_requests в разобранном виде: тип переведён в перечисление, имена
+// остановок и маршрутов заранее найдены в каталоге, и выполнение работает
+// с простыми структурами, не обращаясь к JSON
+namespace requests {
+
+    enum class RequestType {
+        STOP,
+        BUS,
+        MAP,
+        ROUTE,
+        NEAREST_STOPS,
+        SUGGEST
+    };
+
+    // Пусто, если тип неизвестен
+    std::optional<RequestType> ParseRequestType(std::string_view name);
+
+    // Указатели пусты, если такого имени в каталоге нет
+    struct StopRequest {
+        const tc::Stop* stop = nullptr;
+    };
+
+    struct BusRequest {
+        const tc::Bus* bus = nullptr;
+    };
+
+    struct MapRequest {
+    };
+
+    struct RouteRequest {
+        const tc::Stop* from = nullptr;
+        const tc::Stop* to = nullptr;
+    };
+
+    struct NearestStopsRequest {
+        geo::Coordinates from;
+        size_t count = 0;
+    };
+
+    struct SuggestRequest {
+        // Указывает в документ запросов
+        std::string_view prefix;
+        size_t count = 0;
+    };
+
+    // Альтернативы идут в порядке RequestType
+    using Query = std::variant<StopRequest, BusRequest, MapRequest, RouteRequest, NearestStopsRequest, SuggestRequest>;
+
+    struct StatRequest {
+        int id = 0;
+        Query query;
+    };
+
+    // Запросы действительны, пока живы версия каталога db и документ запросов.
+    // Запросы неизвестных типов пропускаются
+    std::vector<StatRequest> Decode(const json::Node& stat_requests, const tc::Catalogue& db);
+
+} // namespace requests
@@ -0,0 +1,312 @@
+#include "stream_base.h"
+
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace stream {
+
+    namespace {
+        const char MAGIC[8] = { 'T', 'C', 'S', 'T', 'R', 'E', 'A', 'M' };
+        const uint32_t STREAM_VERSION = 1;
+        // Столько элементов списка попадает в одну запись
+        const size_t BATCH_SIZE = 1024;
+        // Запись длиннее этого считается мусором, а не данными
+        const uint64_t MAX_RECORD_SIZE = 1ull << 30;
+
+        [[noreturn]] void ThrowCorrupted() {
+            throw runtime_error("Corrupted stream base"s);
+        }
+
+        class RecordWriter {
+        public:
+            explicit RecordWriter(ostream& output)
+                : output_(output) {}
+
+            void Write(const serialize::StreamRecord& record) {
+                record.SerializeToString(&buffer_);
+                uint64_t size = buffer_.size();
+                while (size >= 0x80) {
+                    output_.put(static_cast<char>((size & 0x7F) | 0x80));
+                    size >>= 7;
+                }
+                output_.put(static_cast<char>(size));
+                output_.write(buffer_.data(), buffer_.size());
+            }
+
+            // Вызывает add(record, i) для i из [0, count), сбрасывая запись каждые BATCH_SIZE элементов
+            template <typename Add>
+            void WriteBatches(size_t count, Add add) {
+                serialize::StreamRecord record;
+                for (size_t i = 0; i < count; ++i) {
+                    add(record, i);
+                    if ((i + 1) % BATCH_SIZE == 0 || i + 1 == count) {
+                        Write(record);
+                        record.Clear();
+                    }
+                }
+            }
+
+        private:
+            ostream& output_;
+            string buffer_;
+        };
+
+        class RecordReader {
+        public:
+            explicit RecordReader(istream& input)
+                : input_(input) {}
+
+            // false, если поток закончился ровно на границе записи
+            bool Read(serialize::StreamRecord& record) {
+                uint64_t size = 0;
+                for (int shift = 0;; shift += 7) {
+                    const int c = input_.get();
+                    if (c == char_traits<char>::eof()) {
+                        if (shift == 0) return false;
+                        ThrowCorrupted();
+                    }
+                    size |= static_cast<uint64_t>(c & 0x7F) << shift;
+                    if (!(c & 0x80)) break;
+                    if (shift >= 56) ThrowCorrupted();
+                }
+                if (size > MAX_RECORD_SIZE) {
+                    ThrowCorrupted();
+                }
+                buffer_.resize(size);
+                if (!input_.read(buffer_.data(), size) || !record.ParseFromString(buffer_)) {
+                    ThrowCorrupted();
+                }
+                return true;
+            }
+
+        private:
+            istream& input_;
+            string buffer_;
+        };
+
+        // Собирает базу по мере поступления записей
+        class BaseBuilder {
+        public:
+            void Apply(const serialize::StreamRecord& record) {
+                if (ended_ || (record.version() != 0 && record.version() != STREAM_VERSION)) {
+                    ThrowCorrupted();
+                }
+                if (record.has_render_settings()) {
+                    render_settings_ = GetRenderSettingsFromDB(record.render_settings());
+                }
+                if (record.has_router_settings()) {
+                    router_settings_ = GetRouterSettingsFromDB(record.router_settings());
+                }
+                for (const string& name : record.string_table()) {
+                    names_.push_back(name);
+                }
+                for (const serialize::Stop& stop : record.stop()) {
+                    if (stop.coordinate_size() != 2) {
+                        ThrowCorrupted();
+                    }
+                    tcat_.AddStop(GetName(stop.name_id()), { stop.coordinate(0), stop.coordinate(1) });
+                }
+                for (const serialize::Stop& stop : record.distance()) {
+                    if (stop.near_stop_id_size() != stop.distance_size()) {
+                        ThrowCorrupted();
+                    }
+                    tc::Stop* from = GetStop(stop.name_id());
+                    for (int j = 0; j < stop.near_stop_id_size(); ++j) {
+                        tcat_.SetDistance(from, GetStop(stop.near_stop_id(j)), stop.distance(j));
+                    }
+                }
+                for (const serialize::Bus& bus : record.bus()) {
+                    vector<tc::Stop*> stops(bus.stop_id_size());
+                    for (size_t j = 0; j < stops.size(); ++j) {
+                        stops[j] = GetStop(bus.stop_id(j));
+                    }
+                    tcat_.AddBus(GetName(bus.name_id()), stops, bus.is_circle());
+                    if (bus.final_stop_id() > 0) {
+                        final_stops_.emplace_back(tcat_.GetAllBuses().size() - 1, GetStop(bus.final_stop_id() - 1));
+                    }
+                }
+                if (record.has_stop_index()) {
+                    tcat_.SetStopIndex(GetNameIndexFromDB(record.stop_index()));
+                }
+                if (record.has_bus_index()) {
+                    tcat_.SetBusIndex(GetNameIndexFromDB(record.bus_index()));
+                }
+                if (record.has_stop_grid()) {
+                    SetStopGridFromDB(tcat_, record.stop_grid());
+                }
+                if (record.has_name_prefixes()) {
+                    const serialize::PrefixIndex& prefixes = record.name_prefixes();
+                    tcat_.SetNamePrefixes(tc::PrefixIndex(prefixes.data(),
+                        { prefixes.block_offset().begin(), prefixes.block_offset().end() }, prefixes.size()));
+                }
+                for (const serialize::Edge& e : record.edge()) {
+                    edges_.push_back({ GetName(e.name_id()), static_cast<size_t>(e.quality()),
+                        static_cast<size_t>(e.from()), static_cast<size_t>(e.to()), e.weight() });
+                }
+                for (const serialize::Vertex& v : record.vertex()) {
+                    incidence_lists_.emplace_back(v.edge_id().begin(), v.edge_id().end());
+                }
+                for (const serialize::StopId& s : record.stop_id()) {
+                    stop_ids_.emplace(GetName(s.name_id()), s.id());
+                }
+                if (record.has_map()) {
+                    map_ = GetMapTextFromDB(record.map());
+                }
+                ended_ = record.end();
+            }
+
+            Base Finish() {
+                if (!ended_ || !render_settings_ || !router_settings_) {
+                    ThrowCorrupted();
+                }
+                // Конечные ищутся через индекс маршрутов, поэтому ставятся после его загрузки
+                for (const auto& [bus, stop] : final_stops_) {
+                    tcat_.SetFinalStop(tcat_.GetAllBuses()[bus].get(), stop);
+                }
+                for (const auto& list : incidence_lists_) {
+                    for (const graph::EdgeId id : list) {
+                        if (id >= edges_.size()) {
+                            ThrowCorrupted();
+                        }
+                    }
+                }
+                tc::Router router(*router_settings_);
+                return { move(tcat_), renderer::MapRenderer(*render_settings_), move(router),
+                    graph::DirectedWeightedGraph<double>(move(edges_), move(incidence_lists_)), move(stop_ids_), move(map_) };
+            }
+
+        private:
+            tc::Catalogue tcat_;
+            vector<string> names_;
+            optional<json::Node> render_settings_;
+            optional<json::Node> router_settings_;
+            vector<graph::Edge<double>> edges_;
+            vector<vector<graph::EdgeId>> incidence_lists_;
+            tc::StopIds stop_ids_;
+            vector<pair<size_t, const tc::Stop*>> final_stops_;
+            optional<renderer::MapText> map_;
+            bool ended_ = false;
+
+            const string& GetName(uint32_t id) const {
+                if (id >= names_.size()) {
+                    ThrowCorrupted();
+                }
+                return names_[id];
+            }
+
+            tc::Stop* GetStop(uint32_t id) const {
+                const auto& all_stops = tcat_.GetAllStops();
+                if (id >= all_stops.size()) {
+                    ThrowCorrupted();
+                }
+                return all_stops[id].get();
+            }
+        };
+    }
+
+    bool IsStreamBase(istream& input) {
+        char magic[sizeof(MAGIC)] = {};
+        const auto position = input.tellg();
+        input.read(magic, sizeof(magic));
+        const bool result = input.gcount() == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+        input.clear();
+        input.seekg(position);
+        return result;
+    }
+
+    void Serialize(const tc::Catalogue& tcat,
+        const renderer::MapRenderer& renderer, const tc::Router& router,
+        const optional<renderer::MapText>& map,
+        ostream& output) {
+        output.write(MAGIC, sizeof(MAGIC));
+        RecordWriter writer(output);
+
+        serialize::StreamRecord header;
+        header.set_version(STREAM_VERSION);
+        *header.mutable_render_settings() = GetRenderSettingSerialize(renderer.GetRenderSettings());
+        *header.mutable_router_settings() = GetRouterSettingSerialize(router.GetSettings());
+        writer.Write(header);
+
+        // Сначала имена остановок, чтобы номер строки совпадал с номером остановки
+        const auto& stops = tcat.GetAllStops();
+        const auto& buses = tcat.GetAllBuses();
+        NameIds ids;
+        writer.WriteBatches(stops.size() + buses.size(), [&](serialize::StreamRecord& record, size_t i) {
+            const string_view name = i < stops.size() ? stops[i]->name : buses[i - stops.size()]->name;
+            ids.emplace(name, static_cast<uint32_t>(i));
+            record.add_string_table(string(name));
+            });
+
+        writer.WriteBatches(stops.size(), [&](serialize::StreamRecord& record, size_t i) {
+            serialize::Stop& stop = *record.add_stop();
+            stop.set_name_id(static_cast<uint32_t>(i));
+            stop.add_coordinate(stops[i]->coordinates.lat);
+            stop.add_coordinate(stops[i]->coordinates.lng);
+            });
+        writer.WriteBatches(stops.size(), [&](serialize::StreamRecord& record, size_t i) {
+            serialize::Stop& stop = *record.add_distance();
+            stop.set_name_id(static_cast<uint32_t>(i));
+            for (const auto& [n, d] : stops[i]->stop_distances) {
+                stop.add_near_stop_id(ids.at(n));
+                stop.add_distance(d);
+            }
+            });
+        writer.WriteBatches(buses.size(), [&](serialize::StreamRecord& record, size_t i) {
+            *record.add_bus() = ::Serialize(buses[i].get(), ids);
+            });
+
+        serialize::StreamRecord indexes;
+        *indexes.mutable_stop_index() = ::Serialize(tcat.GetStopIndex());
+        *indexes.mutable_bus_index() = ::Serialize(tcat.GetBusIndex());
+        *indexes.mutable_stop_grid() = ::Serialize(tcat.GetStopGrid());
+        *indexes.mutable_name_prefixes() = ::Serialize(tcat.GetNamePrefixes());
+        writer.Write(indexes);
+
+        const graph::DirectedWeightedGraph<double>& g = router.GetGraph();
+        writer.WriteBatches(g.GetEdgeCount(), [&](serialize::StreamRecord& record, size_t i) {
+            *record.add_edge() = ::Serialize(g.GetEdge(i), ids);
+            });
+        writer.WriteBatches(g.GetVertexCount(), [&](serialize::StreamRecord& record, size_t i) {
+            *record.add_vertex() = GetVertexSerialize(g, i);
+            });
+        auto stop_id = router.GetStopIds().begin();
+        writer.WriteBatches(router.GetStopIds().size(), [&](serialize::StreamRecord& record, size_t) {
+            serialize::StopId& s = *record.add_stop_id();
+            s.set_name_id(ids.at(stop_id->first));
+            s.set_id(stop_id->second);
+            ++stop_id;
+            });
+
+        if (map) {
+            serialize::StreamRecord record;
+            *record.mutable_map() = ::Serialize(*map);
+            writer.Write(record);
+        }
+
+        serialize::StreamRecord end;
+        end.set_end(true);
+        writer.Write(end);
+    }
+
+    Base Deserialize(istream& input) {
+        char magic[sizeof(MAGIC)];
+        if (!input.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            ThrowCorrupted();
+        }
+        RecordReader reader(input);
+        BaseBuilder builder;
+        serialize::StreamRecord record;
+        while (reader.Read(record)) {
+            builder.Apply(record);
+            record.Clear();
+        }
+        return builder.Finish();
+    }
+
+} // namespace stream
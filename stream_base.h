@@ -0,0 +1,24 @@
+#pragma once
+
+#include "serialization.h"
+
+#include <iostream>
+
+// Потоковая база: сигнатура и последовательность небольших записей StreamRecord.
+// Остановки, маршруты, рёбра и прочие списки пишутся пачками ограниченного размера,
+// поэтому ни запись, ни чтение не держат в памяти полную protobuf-копию каталога.
+namespace stream {
+
+    // Проверяет сигнатуру в начале потока; позиция потока возвращается на место
+    bool IsStreamBase(std::istream& input);
+
+    void Serialize(const tc::Catalogue& tcat,
+        const renderer::MapRenderer& renderer,
+        const tc::Router& router,
+        const std::optional<renderer::MapText>& map,
+        std::ostream& output);
+
+    // Бросает std::runtime_error, если база повреждена или обрезана
+    Base Deserialize(std::istream& input);
+
+} // namespace stream
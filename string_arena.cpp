@@ -0,0 +1,43 @@
+#include "string_arena.h"
+
+#include <cstring>
+
+namespace tc {
+
+    std::string_view StringArena::Store(std::string_view str) {
+        if (str.empty()) return {};
+        for (const std::string_view region : regions_) {
+            if (str.data() >= region.data() && str.data() + str.size() <= region.data() + region.size()) {
+                return str;
+            }
+        }
+        if (str.size() > left_) {
+            // Длинные строки получают собственный блок, не сбрасывая текущий
+            if (str.size() > BLOCK_SIZE / 4) {
+                blocks_.push_back(std::make_unique<char[]>(str.size()));
+                std::memcpy(blocks_.back().get(), str.data(), str.size());
+                used_ += str.size();
+                return { blocks_.back().get(), str.size() };
+            }
+            blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            current_ = blocks_.back().get();
+            left_ = BLOCK_SIZE;
+        }
+        char* result = current_;
+        std::memcpy(result, str.data(), str.size());
+        current_ += str.size();
+        left_ -= str.size();
+        used_ += str.size();
+        return { result, str.size() };
+    }
+
+    void StringArena::Adopt(std::shared_ptr<const void> owner, std::string_view region) {
+        owners_.push_back(std::move(owner));
+        regions_.push_back(region);
+    }
+
+    size_t StringArena::GetUsedBytes() const {
+        return used_;
+    }
+
+} // namespace tc
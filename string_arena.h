@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace tc {
+
+    // Хранилище имён каталога: строки укладываются подряд в крупные блоки,
+    // выданные string_view остаются валидными до уничтожения арены
+    class StringArena {
+    public:
+        StringArena() = default;
+        StringArena(const StringArena&) = delete;
+        StringArena& operator=(const StringArena&) = delete;
+        StringArena(StringArena&&) = default;
+        StringArena& operator=(StringArena&&) = default;
+
+        // Строки, лежащие внутри принятой внешней области, не копируются
+        std::string_view Store(std::string_view str);
+
+        // Принимает неизменяемую внешнюю область со строками (например, отображённый файл);
+        // owner удерживает её, пока жива арена
+        void Adopt(std::shared_ptr<const void> owner, std::string_view region);
+
+        // Объём памяти, занятый строками
+        size_t GetUsedBytes() const;
+
+    private:
+        static const size_t BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* current_ = nullptr;
+        size_t left_ = 0;
+        size_t used_ = 0;
+        std::vector<std::shared_ptr<const void>> owners_;
+        std::vector<std::string_view> regions_;
+    };
+
+} // namespace tc
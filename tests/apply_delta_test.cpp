@@ -0,0 +1,156 @@
+#include "test_utils.h"
+
+#include "json.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+    const string BASE_REQUESTS = R"(
+        "base_requests": [
+            { "type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60,
+              "road_distances": { "B": 1500, "C": 2000, "D": 3000 } },
+            { "type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.61,
+              "road_distances": { "C": 1800 } },
+            { "type": "Stop", "name": "C", "latitude": 55.62, "longitude": 37.60,
+              "road_distances": { "D": 1200 } },
+            { "type": "Stop", "name": "D", "latitude": 55.63, "longitude": 37.62, "road_distances": {} },
+            { "type": "Stop", "name": "E", "latitude": 55.64, "longitude": 37.64, "road_distances": {} },
+            { "type": "Bus", "name": "1", "stops": ["A", "B", "C"], "is_roundtrip": false },
+            { "type": "Bus", "name": "2", "stops": ["C", "D"], "is_roundtrip": false },
+            { "type": "Bus", "name": "3", "stops": ["A", "D", "A"], "is_roundtrip": true }
+        ])";
+
+    // Новая остановка, сдвиг остановки без новых расстояний, новое расстояние,
+    // изменённый, новый и удалённый маршруты, удалённая остановка
+    const string DELTA_REQUESTS = R"(
+        "delta_requests": [
+            { "type": "Stop", "name": "F", "latitude": 55.65, "longitude": 37.65,
+              "road_distances": { "D": 700, "B": 2200 } },
+            { "type": "Stop", "name": "B", "latitude": 55.615, "longitude": 37.615, "road_distances": {} },
+            { "type": "Stop", "name": "C", "latitude": 55.62, "longitude": 37.60,
+              "road_distances": { "D": 1000 } },
+            { "type": "Bus", "name": "2", "stops": ["C", "D", "F"], "is_roundtrip": false },
+            { "type": "Bus", "name": "4", "stops": ["B", "F"], "is_roundtrip": false },
+            { "type": "RemoveBus", "name": "3" },
+            { "type": "RemoveStop", "name": "E" }
+        ])";
+
+    // Тот же каталог, что получается после дельты, собранный с нуля
+    const string REBUILT_REQUESTS = R"(
+        "base_requests": [
+            { "type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60,
+              "road_distances": { "B": 1500, "C": 2000, "D": 3000 } },
+            { "type": "Stop", "name": "B", "latitude": 55.615, "longitude": 37.615,
+              "road_distances": { "C": 1800 } },
+            { "type": "Stop", "name": "C", "latitude": 55.62, "longitude": 37.60,
+              "road_distances": { "D": 1000 } },
+            { "type": "Stop", "name": "D", "latitude": 55.63, "longitude": 37.62, "road_distances": {} },
+            { "type": "Stop", "name": "F", "latitude": 55.65, "longitude": 37.65,
+              "road_distances": { "D": 700, "B": 2200 } },
+            { "type": "Bus", "name": "1", "stops": ["A", "B", "C"], "is_roundtrip": false },
+            { "type": "Bus", "name": "2", "stops": ["C", "D", "F"], "is_roundtrip": false },
+            { "type": "Bus", "name": "4", "stops": ["B", "F"], "is_roundtrip": false }
+        ])";
+
+    const char* const STOPS[] = { "A", "B", "C", "D", "E", "F" };
+    const char* const BUSES[] = { "1", "2", "3", "4" };
+
+    // Все остановки и маршруты, маршруты между всеми парами остановок, карта и поиск
+    string StatRequests() {
+        ostringstream out;
+        out << R"("stat_requests": [ { "id": 0, "type": "Map" })";
+        int id = 1;
+        for (const char* stop : STOPS) {
+            out << R"(, { "id": )" << id++ << R"(, "type": "Stop", "name": ")" << stop << R"(" })";
+        }
+        for (const char* bus : BUSES) {
+            out << R"(, { "id": )" << id++ << R"(, "type": "Bus", "name": ")" << bus << R"(" })";
+        }
+        for (const char* from : STOPS) {
+            for (const char* to : STOPS) {
+                out << R"(, { "id": )" << id++ << R"(, "type": "Route", "from": ")" << from
+                    << R"(", "to": ")" << to << R"(" })";
+            }
+        }
+        out << R"(, { "id": )" << id++ << R"(, "type": "NearestStops", "latitude": 55.62, "longitude": 37.61, "count": 4 })";
+        out << R"(, { "id": )" << id++ << R"(, "type": "Suggest", "prefix": "", "count": 10 })";
+        out << " ]";
+        return out.str();
+    }
+
+    string SerializationSettings(const string& file, const string& format) {
+        return R"({ "file": ")"s + file + R"(", "format": ")"s + format + R"(", "prerender_map": true })"s;
+    }
+
+    string ReadFile(const string& path) {
+        ifstream input(path, ios::binary);
+        return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+
+    class ApplyDeltaTest : public testing::TestWithParam<string> {
+    };
+
+}
+
+TEST_P(ApplyDeltaTest, MatchesFullRebuild) {
+    const test::TempPath updated_file;
+    const test::TempPath rebuilt_file;
+    const string updated_settings = SerializationSettings(updated_file.Get(), GetParam());
+    const string rebuilt_settings = SerializationSettings(rebuilt_file.Get(), GetParam());
+
+    test::MakeBase(test::MakeInput(updated_settings, BASE_REQUESTS));
+    test::ApplyDelta(test::MakeInput(updated_settings, DELTA_REQUESTS));
+    test::MakeBase(test::MakeInput(rebuilt_settings, REBUILT_REQUESTS));
+
+    istringstream updated_output(test::ProcessRequests(test::MakeInput(updated_settings, StatRequests())));
+    istringstream rebuilt_output(test::ProcessRequests(test::MakeInput(rebuilt_settings, StatRequests())));
+    const json::Document updated = json::Load(updated_output);
+    const json::Document rebuilt = json::Load(rebuilt_output);
+    const json::Array& updated_responses = updated.GetRoot().AsArray();
+    const json::Array& rebuilt_responses = rebuilt.GetRoot().AsArray();
+
+    ASSERT_EQ(updated_responses.size(), rebuilt_responses.size());
+    for (size_t i = 0; i < updated_responses.size(); ++i) {
+        const json::Dict& lhs = updated_responses[i].AsDict();
+        const json::Dict& rhs = rebuilt_responses[i].AsDict();
+        // Среди маршрутов равной длительности граф после дельты может выбрать другой
+        if (lhs.count("total_time"s) && rhs.count("total_time"s)) {
+            EXPECT_NEAR(lhs.at("total_time"s).AsDouble(), rhs.at("total_time"s).AsDouble(), 1e-6)
+                << "request " << lhs.at("request_id"s).AsInt();
+        }
+        else {
+            EXPECT_EQ(updated_responses[i], rebuilt_responses[i]) << "request " << lhs.at("request_id"s).AsInt();
+        }
+    }
+}
+
+TEST_P(ApplyDeltaTest, RejectsUnknownStops) {
+    const test::TempPath file;
+    const string settings = SerializationSettings(file.Get(), GetParam());
+    test::MakeBase(test::MakeInput(settings, BASE_REQUESTS));
+    const string original = ReadFile(file.Get());
+
+    const string bad_deltas[] = {
+        R"("delta_requests": [ { "type": "Bus", "name": "5", "stops": ["A", "Q"], "is_roundtrip": false } ])",
+        R"("delta_requests": [ { "type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60,
+                                 "road_distances": { "Q": 100 } } ])",
+        R"("delta_requests": [ { "type": "Stop", "name": "G", "latitude": 55.66, "longitude": 37.66,
+                                 "road_distances": { "Q": 100 } } ])",
+    };
+    for (const string& delta : bad_deltas) {
+        EXPECT_THROW(test::ApplyDelta(test::MakeInput(settings, delta)), invalid_argument) << delta;
+        EXPECT_EQ(ReadFile(file.Get()), original);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllFormats, ApplyDeltaTest,
+    testing::Values("protobuf"s, "flat"s, "compressed"s, "stream"s));
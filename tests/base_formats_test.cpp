@@ -0,0 +1,163 @@
+#include "test_utils.h"
+
+#include "json.h"
+#include "stream_base.h"
+
+#include <transport_catalogue.pb.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+
+    // Маршрут A назван как остановка A, а остановка Y — как маршрут Y: в таблице строк
+    // базы такие имена совпадают, но номера остальных маршрутов не должны съезжать.
+    // Маршруты попадают в каталог не в порядке запросов, поэтому совпадающие имена стоят
+    // в начале и в конце списка: хотя бы одно окажется перед остальными маршрутами
+    const string BASE_REQUESTS = R"(
+        "base_requests": [
+            { "type": "Bus", "name": "A", "stops": ["A", "C", "A"], "is_roundtrip": true },
+            { "type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60,
+              "road_distances": { "B": 1500, "C": 2000 } },
+            { "type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.61,
+              "road_distances": { "C": 1800, "Y": 900 } },
+            { "type": "Stop", "name": "C", "latitude": 55.62, "longitude": 37.60,
+              "road_distances": { "D": 1200 } },
+            { "type": "Stop", "name": "D", "latitude": 55.63, "longitude": 37.62,
+              "road_distances": { "Y": 2500 } },
+            { "type": "Stop", "name": "Y", "latitude": 55.60, "longitude": 37.63, "road_distances": {} },
+            { "type": "Bus", "name": "Z", "stops": ["A", "B", "Y"], "is_roundtrip": false },
+            { "type": "Bus", "name": "X", "stops": ["C", "D"], "is_roundtrip": false },
+            { "type": "Bus", "name": "W", "stops": ["D", "Y"], "is_roundtrip": false },
+            { "type": "Bus", "name": "Y", "stops": ["B", "C", "D"], "is_roundtrip": false }
+        ])";
+
+    const string STAT_REQUESTS = R"(
+        "stat_requests": [
+            { "id": 1, "type": "Stop", "name": "A" },
+            { "id": 2, "type": "Stop", "name": "Y" },
+            { "id": 3, "type": "Stop", "name": "D" },
+            { "id": 4, "type": "Stop", "name": "Z" },
+            { "id": 5, "type": "Bus", "name": "A" },
+            { "id": 6, "type": "Bus", "name": "Y" },
+            { "id": 7, "type": "Bus", "name": "Z" },
+            { "id": 8, "type": "Bus", "name": "B" },
+            { "id": 9, "type": "Route", "from": "A", "to": "C" },
+            { "id": 10, "type": "Route", "from": "B", "to": "D" },
+            { "id": 11, "type": "Route", "from": "Y", "to": "C" },
+            { "id": 12, "type": "Route", "from": "D", "to": "A" },
+            { "id": 13, "type": "Route", "from": "A", "to": "A" },
+            { "id": 14, "type": "Map" },
+            { "id": 15, "type": "NearestStops", "latitude": 55.61, "longitude": 37.61, "count": 3 },
+            { "id": 16, "type": "Suggest", "prefix": "A", "count": 5 },
+            { "id": 17, "type": "Suggest", "prefix": "", "count": 10 },
+            { "id": 18, "type": "Route", "from": "D", "to": "Y" }
+        ])";
+
+    string SerializationSettings(const string& file, const string& format, bool prerender_map) {
+        return R"({ "file": ")"s + file + R"(", "format": ")"s + format + R"(", "prerender_map": )"s
+            + (prerender_map ? "true"s : "false"s) + " }"s;
+    }
+
+    // Строки ответов лежат в арене документа, поэтому возвращается сам документ
+    json::Document ParseResponses(const string& output) {
+        istringstream input(output);
+        return json::Load(input);
+    }
+
+    // Маршруты, которыми проезжает ответ на запрос Route
+    vector<string> RouteBuses(const json::Node& response) {
+        vector<string> buses;
+        for (const json::Node& item : response.AsDict().at("items"s).AsArray()) {
+            if (item.AsDict().at("type"s).AsString() == "Bus"s) {
+                buses.emplace_back(item.AsDict().at("bus"s).AsString());
+            }
+        }
+        return buses;
+    }
+
+    class BaseFormatTest : public testing::TestWithParam<tuple<string, bool>> {
+    };
+
+    // Потоковая база из двух остановок и одной записи extra, которая на них ссылается
+    string MakeStreamBase(const serialize::StreamRecord& extra) {
+        serialize::StreamRecord stops;
+        stops.add_string_table("A"s);
+        stops.add_string_table("B"s);
+        for (uint32_t id : { 0u, 1u }) {
+            serialize::Stop* stop = stops.add_stop();
+            stop->set_name_id(id);
+            stop->add_coordinate(55.6);
+            stop->add_coordinate(37.6);
+        }
+        string result = "TCSTREAM"s;
+        // Записи короче 128 байт, поэтому длина занимает один байт
+        const auto append = [&result](const serialize::StreamRecord& record) {
+            const string data = record.SerializeAsString();
+            result += static_cast<char>(data.size());
+            result += data;
+        };
+        append(stops);
+        append(extra);
+        return result;
+    }
+
+    void DeserializeStream(const string& data) {
+        istringstream input(data);
+        stream::Deserialize(input);
+    }
+
+}
+
+TEST_P(BaseFormatTest, RoundTripMatchesInMemoryCatalogue) {
+    const auto& [format, prerender_map] = GetParam();
+    const test::TempPath file;
+    const string settings = SerializationSettings(file.Get(), format, prerender_map);
+
+    test::MakeBase(test::MakeInput(settings, BASE_REQUESTS));
+    const string output = test::ProcessRequests(test::MakeInput(settings, STAT_REQUESTS));
+    const string expected = test::ProcessInMemory(test::MakeInput(settings, BASE_REQUESTS + ","s + STAT_REQUESTS));
+    EXPECT_EQ(output, expected);
+
+    const json::Document document = ParseResponses(output);
+    const json::Array& responses = document.GetRoot().AsArray();
+    ASSERT_EQ(responses.size(), 18u);
+    EXPECT_EQ(responses[0].AsDict().at("buses"s), json::Node(json::Array{ "A"s, "Z"s }));
+    EXPECT_EQ(responses[1].AsDict().at("buses"s), json::Node(json::Array{ "W"s, "Z"s }));
+    EXPECT_EQ(responses[4].AsDict().at("stop_count"s).AsInt(), 3);
+    EXPECT_EQ(responses[4].AsDict().at("route_length"s).AsInt(), 4000);
+    EXPECT_EQ(responses[5].AsDict().at("stop_count"s).AsInt(), 5);
+    EXPECT_EQ(RouteBuses(responses[8]), vector<string>{ "A"s });
+    EXPECT_EQ(RouteBuses(responses[9]), vector<string>{ "Y"s });
+    EXPECT_EQ(RouteBuses(responses[10]), (vector<string>{ "Z"s, "Y"s }));
+    EXPECT_EQ(RouteBuses(responses[17]), vector<string>{ "W"s });
+}
+
+INSTANTIATE_TEST_SUITE_P(AllFormats, BaseFormatTest,
+    testing::Combine(testing::Values("protobuf"s, "flat"s, "compressed"s, "stream"s), testing::Bool()));
+
+TEST(StreamBase, RejectsUnknownStopIds) {
+    serialize::StreamRecord distance;
+    serialize::Stop* from = distance.add_distance();
+    from->set_name_id(2);
+    EXPECT_THROW(DeserializeStream(MakeStreamBase(distance)), runtime_error);
+
+    from->set_name_id(0);
+    from->add_near_stop_id(7);
+    from->add_distance(100);
+    EXPECT_THROW(DeserializeStream(MakeStreamBase(distance)), runtime_error);
+
+    serialize::StreamRecord bus;
+    bus.add_bus()->add_stop_id(5);
+    EXPECT_THROW(DeserializeStream(MakeStreamBase(bus)), runtime_error);
+
+    bus.mutable_bus(0)->set_stop_id(0, 1);
+    bus.mutable_bus(0)->set_final_stop_id(9);
+    EXPECT_THROW(DeserializeStream(MakeStreamBase(bus)), runtime_error);
+}
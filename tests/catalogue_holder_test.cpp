@@ -0,0 +1,116 @@
+#include "transport_catalogue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    // Остановки A и B, маршрут 1 между ними
+    tc::Catalogue MakeCatalogue() {
+        tc::Catalogue catalogue;
+        catalogue.AddStop("A"s, { 55.6, 37.6 });
+        catalogue.AddStop("B"s, { 55.7, 37.7 });
+        catalogue.SetDistance(catalogue.FindStop("A"s), catalogue.FindStop("B"s), 1000);
+        catalogue.AddBus("1"s, { catalogue.FindStop("A"s), catalogue.FindStop("B"s) }, false);
+        return catalogue;
+    }
+
+}
+
+TEST(CatalogueHolder, OldSnapshotKeepsItsVersion) {
+    tc::CatalogueHolder holder(MakeCatalogue());
+    const tc::CatalogueHolder::Snapshot before = holder.Acquire();
+
+    holder.Update([](tc::Catalogue& catalogue) {
+        catalogue.AddStop("C"s, { 55.8, 37.8 });
+        catalogue.SetStopCoordinates(catalogue.FindStop("A"s), { 10.0, 20.0 });
+        catalogue.SetDistance(catalogue.FindStop("A"s), catalogue.FindStop("B"s), 2000);
+        catalogue.SetBusStops(catalogue.FindBus("1"s),
+            { catalogue.FindStop("A"s), catalogue.FindStop("B"s), catalogue.FindStop("C"s) }, false);
+        });
+    const tc::CatalogueHolder::Snapshot after = holder.Acquire();
+
+    // Старая версия не видит ни одного изменения
+    EXPECT_EQ(before->FindStop("C"s), nullptr);
+    EXPECT_EQ(before->GetAllStops().size(), 2u);
+    EXPECT_DOUBLE_EQ(before->FindStop("A"s)->coordinates.lat, 55.6);
+    EXPECT_EQ(before->GetDistance(before->FindStop("A"s), before->FindStop("B"s)), 1000);
+    EXPECT_EQ(before->FindBus("1"s)->stops.size(), 2u);
+
+    ASSERT_NE(after->FindStop("C"s), nullptr);
+    EXPECT_DOUBLE_EQ(after->FindStop("A"s)->coordinates.lat, 10.0);
+    EXPECT_EQ(after->GetDistance(after->FindStop("A"s), after->FindStop("B"s)), 2000);
+    EXPECT_EQ(after->FindBus("1"s)->stops.size(), 3u);
+    EXPECT_EQ(after->GetBusesOnStop("C"s).size(), 1u);
+}
+
+// Писатель публикует версии, пока читатели выполняют запросы к закреплённым версиям.
+// Версия i содержит остановки S0..S(i-1), а широта остановки A равна i, так что по
+// любой закреплённой версии видно, целиком ли она собрана.
+TEST(CatalogueHolder, ReadersRunAlongsideUpdates) {
+    constexpr int UPDATES = 200;
+    constexpr int READERS = 4;
+
+    tc::CatalogueHolder holder(MakeCatalogue());
+    holder.Update([](tc::Catalogue& catalogue) {
+        catalogue.SetStopCoordinates(catalogue.FindStop("A"s), { 0.0, 0.0 });
+        });
+    const tc::CatalogueHolder::Snapshot first = holder.Acquire();
+
+    atomic<bool> done = false;
+    atomic<int> failures = 0;
+    vector<thread> readers;
+    for (int r = 0; r < READERS; ++r) {
+        readers.emplace_back([&] {
+            int last_version = 0;
+            while (!done.load()) {
+                const tc::CatalogueHolder::Snapshot snapshot = holder.Acquire();
+                const int version = static_cast<int>(snapshot->FindStop("A"s)->coordinates.lat);
+                bool ok = version >= last_version
+                    && snapshot->GetAllStops().size() == static_cast<size_t>(2 + version)
+                    && snapshot->GetSortedAllStops().size() == static_cast<size_t>(2 + version)
+                    && snapshot->FindStop("S"s + to_string(version)) == nullptr
+                    && snapshot->GetDistance(snapshot->FindStop("A"s), snapshot->FindStop("B"s)) == 1000 + version;
+                if (version > 0) {
+                    const tc::Stop* newest = snapshot->FindStop("S"s + to_string(version - 1));
+                    ok = ok && newest != nullptr
+                        && snapshot->GetBusesOnStop(newest->name).size() == 1
+                        && snapshot->FindBus("1"s)->stops.size() == static_cast<size_t>(2 + version)
+                        && snapshot->FindNearestStops(newest->coordinates, 1).front().first == newest;
+                }
+                // Версия, закреплённая до начала обновлений, остаётся прежней
+                ok = ok && first->GetAllStops().size() == 2 && first->FindStop("S0"s) == nullptr
+                    && first->FindBus("1"s)->stops.size() == 2;
+                if (!ok) {
+                    ++failures;
+                }
+                last_version = version;
+            }
+            });
+    }
+
+    for (int i = 1; i <= UPDATES; ++i) {
+        holder.Update([i](tc::Catalogue& catalogue) {
+            const string name = "S"s + to_string(i - 1);
+            catalogue.AddStop(name, { -50.0 + i * 0.1, 100.0 });
+            catalogue.SetStopCoordinates(catalogue.FindStop("A"s), { static_cast<double>(i), 0.0 });
+            catalogue.SetDistance(catalogue.FindStop("A"s), catalogue.FindStop("B"s), 1000 + i);
+            vector<tc::Stop*> stops = catalogue.FindBus("1"s)->stops;
+            stops.push_back(catalogue.FindStop(name));
+            catalogue.SetBusStops(catalogue.FindBus("1"s), stops, false);
+            });
+    }
+    done = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(holder.Acquire()->GetAllStops().size(), static_cast<size_t>(2 + UPDATES));
+}
@@ -0,0 +1,77 @@
+#include "test_utils.h"
+
+#include "json.h"
+#include "mapped_file.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+    // Строки с escape-последовательностями и без, UTF-8, числа всех видов и вложенность
+    const string TEXT = R"({
+        "plain": "Stop A",
+        "escaped": "quote \" backslash \\ tab \t newline \n",
+        "escaped_utf8": "Улица \"Заречная\"\r",
+        "utf8": "Улица Лизы Чайкиной",
+        "empty": "",
+        "numbers": [0, -1, 2147483647, 1.5, -2.5e-3, 1E10],
+        "flags": [true, false, null],
+        "nested": { "array": [[], {}, [{ "key": "value" }]], "": "empty key" }
+    })";
+
+    void WriteFile(const string& path, string_view text) {
+        ofstream output(path, ios::binary);
+        output << text;
+    }
+
+    bool PointsInto(string_view value, string_view buffer) {
+        return value.data() >= buffer.data() && value.data() + value.size() <= buffer.data() + buffer.size();
+    }
+
+}
+
+TEST(JsonBorrowed, MappedFileMatchesOrdinaryLoad) {
+    const test::TempPath file;
+    WriteFile(file.Get(), TEXT);
+
+    json::Document borrowed = [&file] {
+        auto mapped = make_shared<const MappedFile>(file.Get());
+        const string_view text = mapped->GetData();
+        return json::LoadBorrowed(move(mapped), text);
+        }();
+    // Документ сам удерживает отображение файла
+    EXPECT_EQ(borrowed, json::Load(TEXT));
+
+    const json::Dict& root = borrowed.GetRoot().AsDict();
+    EXPECT_EQ(root.at("plain"s).AsString(), "Stop A"sv);
+    EXPECT_EQ(root.at("escaped"s).AsString(), "quote \" backslash \\ tab \t newline \n"sv);
+    EXPECT_EQ(root.at("escaped_utf8"s).AsString(), "Улица \"Заречная\"\r"sv);
+    EXPECT_EQ(root.at("nested"s).AsDict().at(""s).AsString(), "empty key"sv);
+}
+
+TEST(JsonBorrowed, OnlyStringsWithoutEscapesPointIntoBuffer) {
+    const auto text = make_shared<const string>(TEXT);
+    const json::Document document = json::LoadBorrowed(text, *text);
+    const json::Dict& root = document.GetRoot().AsDict();
+    EXPECT_EQ(document.GetBuffer(), *text);
+    EXPECT_TRUE(PointsInto(root.at("plain"s).AsString(), *text));
+    EXPECT_TRUE(PointsInto(root.at("utf8"s).AsString(), *text));
+    EXPECT_FALSE(PointsInto(root.at("escaped"s).AsString(), *text));
+    EXPECT_FALSE(PointsInto(root.at("escaped_utf8"s).AsString(), *text));
+}
+
+// Буфер отображения не заканчивается нулём: обрезанный в любом месте документ
+// должен давать ошибку разбора, а не чтение за концом буфера
+TEST(JsonBorrowed, TruncatedInputThrowsParsingError) {
+    for (size_t size = 0; size < TEXT.size(); ++size) {
+        const auto text = make_shared<const string>(TEXT.substr(0, size));
+        EXPECT_THROW(json::LoadBorrowed(text, *text), json::ParsingError) << size;
+    }
+}
@@ -0,0 +1,101 @@
+#include "name_index.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    vector<string> MakeNames(size_t count) {
+        vector<string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back("Stop "s + to_string(i));
+        }
+        return names;
+    }
+
+    tc::NameIndex MakeIndex(const vector<string>& names) {
+        return tc::NameIndex(vector<string_view>(names.begin(), names.end()));
+    }
+
+    tc::NameIndex Restore(const tc::NameIndex& index) {
+        return tc::NameIndex(index.GetSalt(), index.GetDisplacements(), index.GetSlots(), index.GetSortedOrder());
+    }
+
+}
+
+// Раньше таблица имела ровно n слотов и индекс не строился уже на сотнях тысяч имён
+TEST(NameIndex, BuildsOverManyNames) {
+    const vector<string> names = MakeNames(300'000);
+    const tc::NameIndex index = MakeIndex(names);
+    ASSERT_EQ(index.Size(), names.size());
+    EXPECT_GT(index.GetSlots().size(), names.size());
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        ASSERT_EQ(index.Find(names[i]), i) << names[i];
+    }
+    const vector<uint32_t>& order = index.GetSortedOrder();
+    for (size_t i = 1; i < order.size(); ++i) {
+        ASSERT_LT(names[order[i - 1]], names[order[i]]);
+    }
+}
+
+TEST(NameIndex, DuplicateNamesAreReported) {
+    const vector<string> names = { "A"s, "B"s, "A"s };
+    try {
+        MakeIndex(names);
+        FAIL() << "duplicate names accepted";
+    } catch (const invalid_argument& e) {
+        EXPECT_NE(string(e.what()).find("Duplicate"), string::npos) << e.what();
+    }
+}
+
+TEST(NameIndex, RestoredIndexMatches) {
+    const vector<string> names = MakeNames(1000);
+    const tc::NameIndex restored = Restore(MakeIndex(names));
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        ASSERT_EQ(restored.Find(names[i]), i);
+    }
+    EXPECT_EQ(Restore(tc::NameIndex{}).Size(), 0u);
+}
+
+TEST(NameIndex, CorruptedIndexIsRejected) {
+    const tc::NameIndex index = MakeIndex(MakeNames(100));
+    const size_t n = index.Size();
+    const auto restore = [&index](vector<uint32_t> slots, vector<uint32_t> order) {
+        return tc::NameIndex(index.GetSalt(), index.GetDisplacements(), move(slots), move(order));
+    };
+
+    vector<uint32_t> slots = index.GetSlots();
+    for (uint32_t& s : slots) {
+        if (s != tc::NameIndex::EMPTY_SLOT) {
+            s = static_cast<uint32_t>(n);
+            break;
+        }
+    }
+    EXPECT_THROW(restore(slots, index.GetSortedOrder()), runtime_error);
+
+    slots = index.GetSlots();
+    for (uint32_t& s : slots) {
+        if (s != tc::NameIndex::EMPTY_SLOT && s != 0) {
+            s = 0;
+            break;
+        }
+    }
+    EXPECT_THROW(restore(slots, index.GetSortedOrder()), runtime_error);
+
+    vector<uint32_t> order = index.GetSortedOrder();
+    order[0] = order[1];
+    EXPECT_THROW(restore(index.GetSlots(), order), runtime_error);
+    order[0] = static_cast<uint32_t>(n);
+    EXPECT_THROW(restore(index.GetSlots(), order), runtime_error);
+
+    EXPECT_THROW(restore(vector<uint32_t>(n - 1, 0), index.GetSortedOrder()), runtime_error);
+    EXPECT_THROW(tc::NameIndex(index.GetSalt(), {}, index.GetSlots(), index.GetSortedOrder()), runtime_error);
+}
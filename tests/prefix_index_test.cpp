@@ -0,0 +1,110 @@
+#include "prefix_index.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    using Kind = tc::PrefixIndex::Kind;
+
+    // Имена из малого алфавита с длинными общими префиксами, в том числе в UTF-8;
+    // часть имён маршрутов совпадает с именами остановок
+    vector<pair<string, Kind>> MakeNames(size_t count) {
+        mt19937 generator(11);
+        const vector<string> parts = { "a", "b", "ab", "Stop ", "\xD0\xA3\xD0\xBB", "1", "" };
+        uniform_int_distribution<size_t> part(0, parts.size() - 1);
+        uniform_int_distribution<int> length(1, 6);
+        vector<pair<string, Kind>> names;
+        for (size_t i = 0; i < count; ++i) {
+            string name;
+            for (int k = length(generator); k > 0; --k) {
+                name += parts[part(generator)];
+            }
+            name += to_string(i % 97);
+            names.emplace_back(name, i % 4 == 0 ? Kind::BUS : Kind::STOP);
+        }
+        for (size_t i = 0; i < count / 10; ++i) {
+            names.emplace_back(names[i * 7 % count].first,
+                names[i * 7 % count].second == Kind::BUS ? Kind::STOP : Kind::BUS);
+        }
+        sort(names.begin(), names.end());
+        names.erase(unique(names.begin(), names.end()), names.end());
+        shuffle(names.begin(), names.end(), generator);
+        return names;
+    }
+
+    tc::PrefixIndex MakeIndex(const vector<pair<string, Kind>>& names) {
+        vector<pair<string_view, Kind>> views;
+        for (const auto& [name, kind] : names) {
+            views.emplace_back(name, kind);
+        }
+        return tc::PrefixIndex(move(views));
+    }
+
+    vector<pair<string, Kind>> BruteForce(vector<pair<string, Kind>> names, string_view prefix, size_t count) {
+        sort(names.begin(), names.end());
+        vector<pair<string, Kind>> result;
+        for (const auto& entry : names) {
+            if (result.size() < count && string_view(entry.first).substr(0, prefix.size()) == prefix) {
+                result.push_back(entry);
+            }
+        }
+        return result;
+    }
+
+    vector<pair<string, Kind>> ToPairs(const vector<tc::PrefixIndex::Entry>& entries) {
+        vector<pair<string, Kind>> result;
+        for (const auto& entry : entries) {
+            result.emplace_back(entry.name, entry.kind);
+        }
+        return result;
+    }
+
+    // Все префиксы части имён, пустой префикс и строки, которых нет среди имён
+    vector<string> MakePrefixes(const vector<pair<string, Kind>>& names) {
+        vector<string> prefixes = { ""s, "zzz"s, "\xFF"s, "Stop Stop Stop Stop Stop Stop Stop "s };
+        for (size_t i = 0; i < names.size(); i += 13) {
+            for (size_t length = 0; length <= names[i].first.size(); ++length) {
+                prefixes.push_back(names[i].first.substr(0, length));
+            }
+            prefixes.push_back(names[i].first + "x"s);
+        }
+        return prefixes;
+    }
+
+}
+
+TEST(PrefixIndex, SuggestMatchesBruteForce) {
+    const vector<pair<string, Kind>> names = MakeNames(1000);
+    const tc::PrefixIndex index = MakeIndex(names);
+    ASSERT_EQ(index.Size(), names.size());
+    for (const string& prefix : MakePrefixes(names)) {
+        for (const size_t count : { size_t{ 1 }, size_t{ 5 }, size_t{ 40 }, names.size() }) {
+            EXPECT_EQ(ToPairs(index.Suggest(prefix, count)), BruteForce(names, prefix, count))
+                << '"' << prefix << "\" " << count;
+        }
+    }
+}
+
+TEST(PrefixIndex, EmptyIndexAndZeroCount) {
+    EXPECT_TRUE(tc::PrefixIndex().Suggest(""s, 10).empty());
+    const tc::PrefixIndex index = MakeIndex(MakeNames(50));
+    EXPECT_TRUE(index.Suggest(""s, 0).empty());
+}
+
+// Индекс, восстановленный из своих частей (как при чтении базы), отвечает так же
+TEST(PrefixIndex, RestoredIndexMatches) {
+    const vector<pair<string, Kind>> names = MakeNames(300);
+    const tc::PrefixIndex index = MakeIndex(names);
+    const tc::PrefixIndex restored(index.GetData(), index.GetBlockOffsets(), index.Size());
+    for (const string& prefix : MakePrefixes(names)) {
+        EXPECT_EQ(ToPairs(restored.Suggest(prefix, 10)), ToPairs(index.Suggest(prefix, 10))) << prefix;
+    }
+}
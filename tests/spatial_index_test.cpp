@@ -0,0 +1,109 @@
+#include "spatial_index.h"
+
+#include "geo.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    // Два плотных скопления и редкие точки вокруг, как остановки города и пригородов
+    vector<geo::Coordinates> MakePoints(size_t count) {
+        mt19937 generator(42);
+        normal_distribution<double> center(0.0, 0.01);
+        uniform_real_distribution<double> spread(-0.5, 0.5);
+        vector<geo::Coordinates> points;
+        for (size_t i = 0; i < count; ++i) {
+            switch (i % 3) {
+            case 0:
+                points.push_back({ 55.75 + center(generator), 37.62 + center(generator) });
+                break;
+            case 1:
+                points.push_back({ 55.60 + center(generator), 37.40 + center(generator) });
+                break;
+            default:
+                points.push_back({ 55.70 + spread(generator), 37.50 + spread(generator) });
+            }
+        }
+        // Совпадающие точки
+        points.push_back(points.front());
+        points.push_back(points.front());
+        return points;
+    }
+
+    vector<double> BruteForceDistances(const vector<geo::Coordinates>& points, geo::Coordinates from, size_t count) {
+        vector<double> distances;
+        for (const geo::Coordinates& point : points) {
+            distances.push_back(geo::ComputeDistance(from, point));
+        }
+        sort(distances.begin(), distances.end());
+        distances.resize(min(count, distances.size()));
+        return distances;
+    }
+
+    void ExpectNearest(const tc::SpatialIndex& index, const vector<geo::Coordinates>& points,
+        geo::Coordinates from, size_t count) {
+        const vector<pair<uint32_t, double>> found = index.FindNearest(from, count);
+        const vector<double> expected = BruteForceDistances(points, from, count);
+        ASSERT_EQ(found.size(), expected.size()) << from.lat << ' ' << from.lng << ' ' << count;
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_LT(found[i].first, points.size());
+            EXPECT_DOUBLE_EQ(found[i].second, geo::ComputeDistance(from, points[found[i].first]));
+            EXPECT_NEAR(found[i].second, expected[i], 1e-6) << from.lat << ' ' << from.lng << ' ' << count << ' ' << i;
+        }
+    }
+
+    vector<geo::Coordinates> MakeQueries() {
+        mt19937 generator(7);
+        uniform_real_distribution<double> lat(54.5, 57.0);
+        uniform_real_distribution<double> lng(36.5, 38.5);
+        // Центры скоплений, точка вне сетки и далеко от неё
+        vector<geo::Coordinates> queries = { { 55.75, 37.62 }, { 55.60, 37.40 }, { 40.0, 10.0 }, { -33.9, 151.2 } };
+        for (int i = 0; i < 50; ++i) {
+            queries.push_back({ lat(generator), lng(generator) });
+        }
+        return queries;
+    }
+
+}
+
+TEST(SpatialIndex, NearestMatchesBruteForce) {
+    const vector<geo::Coordinates> points = MakePoints(3000);
+    const tc::SpatialIndex index(points);
+    ASSERT_EQ(index.Size(), points.size());
+    for (const geo::Coordinates& from : MakeQueries()) {
+        for (const size_t count : { size_t{ 1 }, size_t{ 7 }, size_t{ 100 } }) {
+            ExpectNearest(index, points, from, count);
+        }
+    }
+}
+
+TEST(SpatialIndex, CountAboveSizeReturnsAllPoints) {
+    const vector<geo::Coordinates> points = MakePoints(20);
+    const tc::SpatialIndex index(points);
+    ExpectNearest(index, points, { 55.7, 37.5 }, points.size() + 10);
+    EXPECT_TRUE(index.FindNearest({ 55.7, 37.5 }, 0).empty());
+    EXPECT_TRUE(tc::SpatialIndex().FindNearest({ 55.7, 37.5 }, 5).empty());
+}
+
+TEST(SpatialIndex, SinglePoint) {
+    const vector<geo::Coordinates> points = { { 55.7, 37.5 } };
+    const tc::SpatialIndex index(points);
+    ExpectNearest(index, points, { 55.7, 37.5 }, 3);
+    ExpectNearest(index, points, { 10.0, 20.0 }, 1);
+}
+
+// Сетка, восстановленная из своих частей (как при чтении базы), отвечает так же
+TEST(SpatialIndex, RestoredIndexMatches) {
+    const vector<geo::Coordinates> points = MakePoints(500);
+    const tc::SpatialIndex index(points);
+    const tc::SpatialIndex restored(index.GetLayout(), index.GetCellStart(), index.GetItems(), points);
+    for (const geo::Coordinates& from : MakeQueries()) {
+        EXPECT_EQ(restored.FindNearest(from, 10), index.FindNearest(from, 10));
+    }
+}
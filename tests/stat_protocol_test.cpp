@@ -0,0 +1,196 @@
+#include "test_utils.h"
+
+#include "json.h"
+#include "lazy.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "stat_protocol.h"
+#include "transport_catalogue.h"
+
+#include <gtest/gtest.h>
+
+#include <stat_protocol.pb.h>
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    // Маршрут A назван как остановка: в ответах они различаются только видом номера
+    const string BASE_REQUESTS = R"(
+        "base_requests": [
+            { "type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60,
+              "road_distances": { "B": 1500, "C": 2000 } },
+            { "type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.61,
+              "road_distances": { "C": 1800 } },
+            { "type": "Stop", "name": "C", "latitude": 55.62, "longitude": 37.60, "road_distances": {} },
+            { "type": "Stop", "name": "D", "latitude": 55.63, "longitude": 37.62, "road_distances": {} },
+            { "type": "Bus", "name": "A", "stops": ["A", "C", "A"], "is_roundtrip": true },
+            { "type": "Bus", "name": "B1", "stops": ["A", "B", "C"], "is_roundtrip": false }
+        ])";
+
+    const char* const STOPS[] = { "A", "B", "C", "D", "Q" };
+    const char* const BUSES[] = { "A", "B1", "Q" };
+
+    // Одни и те же запросы в JSON и в RequestBatch; Q нет в базе
+    pair<string, protocol::RequestBatch> MakeRequests(const string& file) {
+        ostringstream json_requests;
+        protocol::RequestBatch batch;
+        batch.set_file(file);
+        batch.set_with_names(true);
+        int id = 0;
+        const auto add_json = [&json_requests, &id](const string& body) {
+            json_requests << (id == 0 ? ""sv : ", "sv) << R"({ "id": )" << id << ", " << body << " }";
+            ++id;
+        };
+        const auto add_binary = [&batch, &id] {
+            protocol::StatRequest* request = batch.add_stat_requests();
+            request->set_id(id);
+            return request;
+        };
+        for (const char* stop : STOPS) {
+            add_binary()->mutable_stop()->set_name(stop);
+            add_json(R"("type": "Stop", "name": ")"s + stop + "\""s);
+        }
+        for (const char* bus : BUSES) {
+            add_binary()->mutable_bus()->set_name(bus);
+            add_json(R"("type": "Bus", "name": ")"s + bus + "\""s);
+        }
+        for (const char* from : STOPS) {
+            for (const char* to : STOPS) {
+                protocol::StatRequest* request = add_binary();
+                request->mutable_route()->set_from(from);
+                request->mutable_route()->set_to(to);
+                add_json(R"("type": "Route", "from": ")"s + from + R"(", "to": ")"s + to + "\""s);
+            }
+        }
+        add_binary()->mutable_map();
+        add_json(R"("type": "Map")"s);
+        return { R"("stat_requests": [ )"s + json_requests.str() + " ]"s, batch };
+    }
+
+    protocol::ResponseBatch ProcessBinary(const protocol::RequestBatch& batch, Execution execution) {
+        optional<LoadedBase> base = OpenBase(batch.file());
+        tc::CatalogueHolder catalogues(move(base->catalogue));
+        RequestHandler handler(catalogues, base->router, base->renderer, base->map, execution);
+        ostringstream out;
+        handler.BinaryStatRequests(batch, out);
+        // Фрагменты ResponseBatch разбираются как одно сообщение
+        protocol::ResponseBatch responses;
+        EXPECT_TRUE(responses.ParseFromString(out.str()));
+        return responses;
+    }
+
+    // Двоичный ответ в том виде, в каком его выдаёт JSON-протокол
+    json::Node ToJson(const protocol::StatResponse& response, const protocol::ResponseBatch& batch) {
+        json::Dict result;
+        result.emplace("request_id"s, response.request_id());
+        switch (response.answer_case()) {
+        case protocol::StatResponse::kNotFound:
+            result.emplace("error_message"s, "not found"s);
+            break;
+        case protocol::StatResponse::kStop: {
+            json::Array buses;
+            for (const uint32_t id : response.stop().bus_id()) {
+                buses.emplace_back(batch.bus_names().at(id));
+            }
+            result.emplace("buses"s, move(buses));
+            break;
+        }
+        case protocol::StatResponse::kBus:
+            result.emplace("curvature"s, response.bus().curvature());
+            result.emplace("route_length"s, response.bus().route_length());
+            result.emplace("stop_count"s, response.bus().stop_count());
+            result.emplace("unique_stop_count"s, response.bus().unique_stop_count());
+            break;
+        case protocol::StatResponse::kRoute: {
+            json::Array items;
+            for (const protocol::RouteItem& item : response.route().item()) {
+                json::Dict converted;
+                if (item.item_case() == protocol::RouteItem::kWaitStopId) {
+                    converted.emplace("type"s, "Wait"s);
+                    converted.emplace("stop_name"s, batch.stop_names().at(item.wait_stop_id()));
+                }
+                else {
+                    converted.emplace("type"s, "Bus"s);
+                    converted.emplace("bus"s, batch.bus_names().at(item.bus_id()));
+                    converted.emplace("span_count"s, item.span_count());
+                }
+                converted.emplace("time"s, item.time());
+                items.emplace_back(move(converted));
+            }
+            result.emplace("items"s, move(items));
+            result.emplace("total_time"s, response.route().total_time());
+            break;
+        }
+        case protocol::StatResponse::kMap:
+            result.emplace("map"s, response.map().svg());
+            break;
+        default:
+            ADD_FAILURE() << "empty answer to request " << response.request_id();
+        }
+        return result;
+    }
+
+    class StatProtocolTest : public testing::TestWithParam<Execution> {
+    };
+
+}
+
+TEST_P(StatProtocolTest, BinaryAnswersMatchJson) {
+    const test::TempPath file;
+    const string settings = R"({ "file": ")"s + file.Get() + R"(" })"s;
+    test::MakeBase(test::MakeInput(settings, BASE_REQUESTS));
+    const auto [json_requests, batch] = MakeRequests(file.Get());
+
+    istringstream json_output(test::ProcessRequests(test::MakeInput(settings, json_requests)));
+    const json::Document expected = json::Load(json_output);
+    const json::Array& expected_responses = expected.GetRoot().AsArray();
+    const protocol::ResponseBatch responses = ProcessBinary(batch, GetParam());
+
+    ASSERT_EQ(static_cast<size_t>(responses.responses_size()), expected_responses.size());
+    for (int i = 0; i < responses.responses_size(); ++i) {
+        const json::Node actual = ToJson(responses.responses(i), responses);
+        // Числа в JSON проходят через текст, а целые значения double читаются как int,
+        // поэтому сравниваются с допуском
+        const json::Dict& lhs = actual.AsDict();
+        const json::Dict& rhs = expected_responses[i].AsDict();
+        ASSERT_EQ(lhs.size(), rhs.size()) << "request " << i;
+        for (const auto& [key, value] : rhs) {
+            if (value.IsDouble()) {
+                EXPECT_NEAR(lhs.at(key).AsDouble(), value.AsDouble(), 1e-5) << "request " << i << ' ' << key;
+            }
+            else if (key == "items"s) {
+                const json::Array& lhs_items = lhs.at(key).AsArray();
+                const json::Array& rhs_items = value.AsArray();
+                ASSERT_EQ(lhs_items.size(), rhs_items.size()) << "request " << i;
+                for (size_t k = 0; k < rhs_items.size(); ++k) {
+                    for (const auto& [item_key, item_value] : rhs_items[k].AsDict()) {
+                        if (item_key == "time"s) {
+                            EXPECT_NEAR(lhs_items[k].AsDict().at(item_key).AsDouble(), item_value.AsDouble(), 1e-5);
+                        }
+                        else {
+                            EXPECT_EQ(lhs_items[k].AsDict().at(item_key), item_value) << "request " << i << ' ' << item_key;
+                        }
+                    }
+                }
+            }
+            else {
+                EXPECT_EQ(lhs.at(key), value) << "request " << i << ' ' << key;
+            }
+        }
+    }
+    // Маршрут A и остановка A попадают в разные таблицы имён
+    EXPECT_TRUE(any_of(responses.bus_names().begin(), responses.bus_names().end(),
+        [](const auto& item) { return item.second == "A"s; }));
+    EXPECT_TRUE(any_of(responses.stop_names().begin(), responses.stop_names().end(),
+        [](const auto& item) { return item.second == "A"s; }));
+}
+
+INSTANTIATE_TEST_SUITE_P(Execution, StatProtocolTest,
+    testing::Values(Execution::SEQUENTIAL, Execution::PARALLEL));
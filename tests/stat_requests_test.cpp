@@ -0,0 +1,71 @@
+#include "stat_requests.h"
+
+#include "json.h"
+#include "transport_catalogue.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <variant>
+#include <vector>
+
+using namespace std;
+
+TEST(StatRequests, ParseRequestType) {
+    EXPECT_EQ(requests::ParseRequestType("Stop"sv), requests::RequestType::STOP);
+    EXPECT_EQ(requests::ParseRequestType("Bus"sv), requests::RequestType::BUS);
+    EXPECT_EQ(requests::ParseRequestType("Map"sv), requests::RequestType::MAP);
+    EXPECT_EQ(requests::ParseRequestType("Route"sv), requests::RequestType::ROUTE);
+    EXPECT_EQ(requests::ParseRequestType("NearestStops"sv), requests::RequestType::NEAREST_STOPS);
+    EXPECT_EQ(requests::ParseRequestType("Suggest"sv), requests::RequestType::SUGGEST);
+    // Имена, попадающие в ту же ячейку таблицы, что и известные, и просто незнакомые
+    for (const string_view name : { ""sv, "Stoq"sv, "Bux"sv, "Mab"sv, "Routes"sv, "stop"sv, "S"sv,
+             "NearestStop"sv, "Suggestion"sv, "Unknown"sv }) {
+        EXPECT_EQ(requests::ParseRequestType(name), nullopt) << name;
+    }
+}
+
+TEST(StatRequests, DecodeResolvesNames) {
+    tc::Catalogue catalogue;
+    catalogue.AddStop("A"s, { 55.6, 37.6 });
+    catalogue.AddStop("B"s, { 55.7, 37.7 });
+    catalogue.SetDistance(catalogue.FindStop("A"s), catalogue.FindStop("B"s), 1000);
+    // Маршрут назван как остановка
+    catalogue.AddBus("A"s, { catalogue.FindStop("A"s), catalogue.FindStop("B"s) }, false);
+    catalogue.BuildIndexes();
+
+    const json::Document document = json::Load(R"([
+        { "id": 1, "type": "Stop", "name": "A" },
+        { "id": 2, "type": "Stop", "name": "Q" },
+        { "id": 3, "type": "Bus", "name": "A" },
+        { "id": 4, "type": "Bus", "name": "B" },
+        { "id": 5, "type": "Unknown", "name": "A" },
+        { "id": 6, "type": "Route", "from": "A", "to": "Q" },
+        { "id": 7, "type": "Map" },
+        { "id": 8, "type": "NearestStops", "latitude": 55.6, "longitude": 37.6, "count": -3 },
+        { "id": 9, "type": "Suggest", "prefix": "A", "count": 2 }
+    ])"sv);
+    const vector<requests::StatRequest> decoded = requests::Decode(document.GetRoot(), catalogue);
+
+    // Запрос неизвестного типа пропущен, порядок остальных сохранён
+    ASSERT_EQ(decoded.size(), 8u);
+    const vector<int> ids = { 1, 2, 3, 4, 6, 7, 8, 9 };
+    for (size_t i = 0; i < ids.size(); ++i) {
+        EXPECT_EQ(decoded[i].id, ids[i]);
+    }
+
+    EXPECT_EQ(get<requests::StopRequest>(decoded[0].query).stop, catalogue.FindStop("A"s));
+    EXPECT_EQ(get<requests::StopRequest>(decoded[1].query).stop, nullptr);
+    EXPECT_EQ(get<requests::BusRequest>(decoded[2].query).bus, catalogue.FindBus("A"s));
+    EXPECT_EQ(get<requests::BusRequest>(decoded[3].query).bus, nullptr);
+    EXPECT_EQ(get<requests::RouteRequest>(decoded[4].query).from, catalogue.FindStop("A"s));
+    EXPECT_EQ(get<requests::RouteRequest>(decoded[4].query).to, nullptr);
+    EXPECT_TRUE(holds_alternative<requests::MapRequest>(decoded[5].query));
+    const auto& nearest = get<requests::NearestStopsRequest>(decoded[6].query);
+    EXPECT_DOUBLE_EQ(nearest.from.lat, 55.6);
+    EXPECT_DOUBLE_EQ(nearest.from.lng, 37.6);
+    EXPECT_EQ(nearest.count, 0u);
+    const auto& suggest = get<requests::SuggestRequest>(decoded[7].query);
+    EXPECT_EQ(suggest.prefix, "A"sv);
+    EXPECT_EQ(suggest.count, 2u);
+}
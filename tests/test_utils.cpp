@@ -0,0 +1,125 @@
+#include "test_utils.h"
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace test {
+
+    namespace {
+
+        json::Document LoadDocument(string_view text) {
+            istringstream input{ string(text) };
+            return json::Load(input);
+        }
+
+        string GetFile(const JsonReader& reader) {
+            return string(reader.GetSerializationSettings().AsDict().at("file"s).AsString());
+        }
+
+    }
+
+    TempPath::TempPath() {
+        static atomic<int> counter = 0;
+        path_ = (filesystem::temp_directory_path()
+            / ("tc_test_"s + to_string(getpid()) + "_"s + to_string(counter++) + ".db"s)).string();
+    }
+
+    TempPath::~TempPath() {
+        remove(path_.c_str());
+        remove((path_ + ".tmp"s).c_str());
+    }
+
+    const string& TempPath::Get() const {
+        return path_;
+    }
+
+    string MakeInput(string_view serialization_settings, string_view requests) {
+        ostringstream out;
+        out << R"({
+            "serialization_settings": )" << serialization_settings << R"(,
+            "routing_settings": { "bus_wait_time": 6, "bus_velocity": 40 },
+            "render_settings": {
+                "width": 1200, "height": 500, "padding": 50,
+                "stop_radius": 5, "line_width": 14,
+                "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+                "stop_label_font_size": 18, "stop_label_offset": [7, -3],
+                "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+                "color_palette": ["green", [255, 160, 0], "red"]
+            },
+            )" << requests << "\n}";
+        return out.str();
+    }
+
+    void MakeBase(string_view input) {
+        tc::Catalogue tcat;
+        JsonReader reader = JsonReader::LoadStreaming(input, tcat);
+        renderer::MapRenderer renderer(reader.GetRenderSettings());
+        tc::Router router(reader.GetRoutingSettings(), tcat);
+        const json::Node& settings = reader.GetSerializationSettings();
+        SaveBase(GetFile(reader), GetBaseFormat(settings), tcat, renderer, router, GetPrerenderMap(settings));
+    }
+
+    string ProcessRequests(string_view input) {
+        JsonReader reader(LoadDocument(input));
+        optional<LoadedBase> base = OpenBase(GetFile(reader));
+        if (!base) {
+            throw runtime_error("Cannot open base "s + GetFile(reader));
+        }
+        tc::CatalogueHolder catalogues(move(base->catalogue));
+        RequestHandler handler(catalogues, base->router, base->renderer, base->map);
+        ostringstream out;
+        handler.JsonStatRequests(reader.GetStatRequest(), out);
+        return out.str();
+    }
+
+    void ApplyDelta(string_view input) {
+        JsonReader reader(LoadDocument(input));
+        const string file = GetFile(reader);
+        const optional<BaseFormat> format = DetectBaseFormat(file);
+        optional<Base> base = format ? LoadBase(file) : nullopt;
+        if (!base) {
+            throw runtime_error("Cannot open base "s + file);
+        }
+        auto& [tcat, renderer, router, graph, stop_ids, map] = *base;
+        const tc::CatalogueChanges changes = reader.ApplyDelta(tcat);
+        router.UpdateGraph(tcat, move(graph), move(stop_ids), changes);
+        // Как в main.cpp: плоская база всё ещё отображена в память, и писать поверх неё нельзя
+        const string tmp_file = file + ".tmp"s;
+        SaveBase(tmp_file, *format, tcat, renderer, router, map.has_value());
+        if (rename(tmp_file.c_str(), file.c_str()) != 0) {
+            throw runtime_error("Cannot replace base "s + file);
+        }
+    }
+
+    string ProcessInMemory(string_view input) {
+        tc::Catalogue tcat;
+        JsonReader reader = JsonReader::LoadStreaming(input, tcat);
+        const Lazy<renderer::MapRenderer> renderer(make_unique<renderer::MapRenderer>(reader.GetRenderSettings()));
+        // Конструктор по каталогу строит только граф, таблицу маршрутов строит конструктор с готовым графом
+        const tc::Router graph_builder(reader.GetRoutingSettings(), tcat);
+        const Lazy<tc::Router> router(make_unique<tc::Router>(reader.GetRoutingSettings(),
+            graph_builder.GetGraph(), graph_builder.GetStopIds()));
+        const Lazy<optional<renderer::MapText>> map(make_unique<optional<renderer::MapText>>());
+        tc::CatalogueHolder catalogues(move(tcat));
+        RequestHandler handler(catalogues, router, renderer, map);
+        ostringstream out;
+        handler.JsonStatRequests(reader.GetStatRequest(), out);
+        return out.str();
+    }
+
+} // namespace test
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace test {
+
+    // Уникальный путь во временном каталоге; файл и его .tmp удаляются вместе с объектом
+    class TempPath {
+    public:
+        TempPath();
+        ~TempPath();
+
+        TempPath(const TempPath&) = delete;
+        TempPath& operator=(const TempPath&) = delete;
+
+        const std::string& Get() const;
+
+    private:
+        std::string path_;
+    };
+
+    // Полный входной документ: настройки маршрутизации и отрисовки общие для всех тестов,
+    // serialization_settings и списки запросов (члены словаря вида "base_requests": [...])
+    // передаются готовыми JSON-фрагментами
+    std::string MakeInput(std::string_view serialization_settings, std::string_view requests);
+
+    // Повторяют режимы make_base, process_requests и apply_delta из main.cpp
+    void MakeBase(std::string_view input);
+
+    std::string ProcessRequests(std::string_view input);
+
+    void ApplyDelta(std::string_view input);
+
+    // Ответы на stat_requests из input по каталогу, собранному из base_requests того же
+    // документа прямо в памяти, без записи базы
+    std::string ProcessInMemory(std::string_view input);
+
+} // namespace test
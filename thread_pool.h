@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Пул потоков фиксированного размера
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // Общий пул на все ядра машины
+    static ThreadPool& GetShared();
+
+    size_t GetThreadCount() const;
+
+    // Ждать результат Submit внутри задачи этого же пула нельзя: все потоки могут оказаться заняты ожиданием
+    template <typename F>
+    std::future<std::invoke_result_t<F>> Submit(F task);
+
+    // Вызывает body(begin, end) для кусков [0, count) размером не больше grain и ждёт их.
+    // Вызывающий поток сам разбирает куски, поэтому вызов безопасен и внутри задачи пула.
+    template <typename F>
+    void ParallelFor(size_t count, size_t grain, F body);
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    bool stopping_ = false;
+
+    void Enqueue(std::function<void()> task);
+    void Run();
+};
+
+template <typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::Submit(F task) {
+    auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::move(task));
+    auto result = packaged->get_future();
+    Enqueue([packaged] { (*packaged)(); });
+    return result;
+}
+
+template <typename F>
+void ThreadPool::ParallelFor(size_t count, size_t grain, F body) {
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunk_count = (count + grain - 1) / grain;
+    if (chunk_count <= 1 || workers_.empty()) {
+        if (count > 0) {
+            body(0, count);
+        }
+        return;
+    }
+
+    struct State {
+        std::atomic<size_t> next{ 0 };
+        size_t done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    // body берётся по ссылке: кусок достаётся только тому, кто успел до завершения вызова
+    const auto work = [state, count, grain, chunk_count, &body] {
+        for (size_t chunk; (chunk = state->next.fetch_add(1)) < chunk_count;) {
+            std::exception_ptr error;
+            try {
+                body(chunk * grain, std::min(count, (chunk + 1) * grain));
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> guard(state->mutex);
+            if (error && !state->error) {
+                state->error = error;
+            }
+            if (++state->done == chunk_count) {
+                state->finished.notify_all();
+            }
+        }
+    };
+    const size_t helpers = std::min(chunk_count - 1, workers_.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        Enqueue(work);
+    }
+    work();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state, chunk_count] { return state->done == chunk_count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
@@ -3,41 +3,106 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 namespace tc {
 
     using namespace std::literals;
 
-    void Catalogue::AddStop(const std::string& name, const geo::Coordinates& coordinates) {
-        all_stops_.push_back(Stop(name, coordinates));
-        Stop* added_stop = &all_stops_.back();
+    namespace {
+
+        template <typename Item>
+        std::vector<std::string_view> CollectNames(const std::vector<std::shared_ptr<Item>>& items) {
+            std::vector<std::string_view> names;
+            names.reserve(items.size());
+            for (const auto& item : items) {
+                names.push_back(item->name);
+            }
+            return names;
+        }
+
+        template <typename Item>
+        std::vector<Item*> GetSortedItems(const std::vector<std::shared_ptr<Item>>& items, const NameIndex& index) {
+            std::vector<Item*> result;
+            result.reserve(items.size());
+            for (const uint32_t i : index.GetSortedOrder()) {
+                result.push_back(items[i].get());
+            }
+            return result;
+        }
+
+        template <typename Item>
+        std::shared_ptr<Item>* FindSlot(const std::vector<std::shared_ptr<Item>>& items, const NameIndex& index,
+            std::string_view name) {
+            if (const auto i = index.Find(name); i && items[*i]->name == name) {
+                return const_cast<std::shared_ptr<Item>*>(&items[*i]);
+            }
+            return nullptr;
+        }
+
+        template <typename Item>
+        Item* FindItem(const std::vector<std::shared_ptr<Item>>& items, const NameIndex& index, std::string_view name) {
+            const auto slot = FindSlot(items, index, name);
+            return slot ? slot->get() : nullptr;
+        }
+
+        template <typename Item>
+        uint32_t GetItemId(const std::vector<std::shared_ptr<Item>>& items, const NameIndex& index, const Item* item) {
+            if (const auto i = index.Find(item->name); i && items[*i].get() == item) {
+                return *i;
+            }
+            throw std::invalid_argument("Object does not belong to this catalogue"s);
+        }
+
+        // Заменяет в отсортированном по имени массиве old_item на fresh_item
+        template <typename Item>
+        void ReplaceSorted(std::vector<Item*>& sorted, const Item* old_item, Item* fresh_item) {
+            auto it = std::lower_bound(sorted.begin(), sorted.end(), fresh_item->name,
+                [](const Item* item, std::string_view name) { return item->name < name; });
+            if (it != sorted.end() && *it == old_item) {
+                *it = fresh_item;
+            }
+        }
+
+    }
+
+    void Catalogue::AddStop(std::string_view name, const geo::Coordinates& coordinates) {
+        all_stops_.push_back(std::make_shared<Stop>(names_->Store(name), coordinates));
+        Stop* added_stop = all_stops_.back().get();
         stop_to_buses_[added_stop->name];
-        stops_list_[added_stop->name] = added_stop;
+        stop_index_ready_ = false;
+        stop_grid_ready_ = false;
+        name_prefixes_ready_ = false;
     }
 
-    void Catalogue::AddBus(const std::string& name, const std::vector<Stop*>& stops, bool is_circle) {
-        all_buses_.push_back(Bus(name, stops, is_circle));
-        Bus* added_bus = &all_buses_.back();
+    void Catalogue::AddBus(std::string_view name, const std::vector<Stop*>& stops, bool is_circle) {
+        all_buses_.push_back(std::make_shared<Bus>(names_->Store(name), stops, is_circle));
+        Bus* added_bus = all_buses_.back().get();
         for (const Stop* s : stops) {
             stop_to_buses_[s->name][added_bus->name] = added_bus;
         }
-        buses_list_[added_bus->name] = added_bus;
+        bus_index_ready_ = false;
+        name_prefixes_ready_ = false;
     }
 
     Stop* Catalogue::FindStop(const std::string_view stop) {
-        return stops_list_.count(stop) ? stops_list_.at(stop) : nullptr;
+        EnsureStopIndex();
+        return FindItem(all_stops_, stop_index_, stop);
     }
 
     const Stop* Catalogue::FindStop(const std::string_view stop) const {
-        return stops_list_.count(stop) ? stops_list_.at(stop) : nullptr;
+        EnsureStopIndex();
+        return FindItem(all_stops_, stop_index_, stop);
     }
 
     Bus* Catalogue::FindBus(const std::string_view bus_name) {
-        return buses_list_.count(bus_name) ? buses_list_.at(bus_name) : nullptr;
+        EnsureBusIndex();
+        return FindItem(all_buses_, bus_index_, bus_name);
     }
 
     const Bus* Catalogue::FindBus(const std::string_view bus_name) const {
-        return buses_list_.count(bus_name) ? buses_list_.at(bus_name) : nullptr;
+        EnsureBusIndex();
+        return FindItem(all_buses_, bus_index_, bus_name);
     }
 
     std::map<std::string_view, Bus*> Catalogue::GetBusesOnStop(const std::string_view stop_name) {
@@ -49,7 +114,7 @@ namespace tc {
     }
 
     void Catalogue::SetDistance(Stop* from, Stop* to, int dist) {
-        from->stop_distances[to->name] = dist;
+        DetachStop(from)->stop_distances[to->name] = dist;
     }
 
     int Catalogue::GetDistance(const Stop* from, const Stop* to) const {
@@ -58,14 +123,262 @@ namespace tc {
         else return 0;
     }
 
-    const std::map<std::string_view, Bus*>& Catalogue::GetSortedAllBuses() const
+    void Catalogue::SetFinalStop(const Bus* bus, const Stop* stop) {
+        Stop* final_stop = stop ? FindStop(stop->name) : nullptr;
+        DetachBus(bus)->final_stop = final_stop;
+    }
+
+    void Catalogue::SetStopCoordinates(const Stop* stop, const geo::Coordinates& coordinates) {
+        DetachStop(stop)->coordinates = coordinates;
+        stop_grid_ready_ = false;
+    }
+
+    void Catalogue::SetBusStops(const Bus* bus, const std::vector<Stop*>& stops, bool is_circle) {
+        Bus* own_bus = DetachBus(bus);
+        for (const Stop* s : own_bus->stops) {
+            stop_to_buses_[s->name].erase(own_bus->name);
+        }
+        own_bus->stops = stops;
+        own_bus->is_circle = is_circle;
+        own_bus->final_stop = nullptr;
+        for (const Stop* s : own_bus->stops) {
+            stop_to_buses_[s->name][own_bus->name] = own_bus;
+        }
+    }
+
+    void Catalogue::RemoveBus(const Bus* bus) {
+        EnsureBusIndex();
+        auto slot = FindSlot(all_buses_, bus_index_, bus->name);
+        if (!slot) {
+            throw std::invalid_argument("Unknown bus "s + std::string(bus->name));
+        }
+        for (const Stop* s : (*slot)->stops) {
+            stop_to_buses_[s->name].erase((*slot)->name);
+        }
+        all_buses_.erase(all_buses_.begin() + (slot - all_buses_.data()));
+        bus_index_ready_ = false;
+        name_prefixes_ready_ = false;
+    }
+
+    void Catalogue::RemoveStop(const Stop* stop) {
+        EnsureStopIndex();
+        auto slot = FindSlot(all_stops_, stop_index_, stop->name);
+        if (!slot) {
+            throw std::invalid_argument("Unknown stop "s + std::string(stop->name));
+        }
+        const std::string_view name = (*slot)->name;
+        if (!stop_to_buses_.at(name).empty()) {
+            throw std::logic_error("Stop "s + std::string(name) + " is used by buses"s);
+        }
+        stop_to_buses_.erase(name);
+        all_stops_.erase(all_stops_.begin() + (slot - all_stops_.data()));
+        stop_index_ready_ = false;
+        stop_grid_ready_ = false;
+        name_prefixes_ready_ = false;
+        // Расстояния до удалённой остановки больше не нужны
+        for (size_t i = 0; i < all_stops_.size(); ++i) {
+            if (all_stops_[i]->stop_distances.count(name)) {
+                DetachStop(all_stops_[i].get())->stop_distances.erase(name);
+            }
+        }
+    }
+
+    std::vector<std::pair<const Stop*, double>> Catalogue::FindNearestStops(const geo::Coordinates& from,
+        size_t count) const {
+        EnsureStopGrid();
+        std::vector<std::pair<const Stop*, double>> result;
+        for (const auto& [i, distance] : stop_grid_.FindNearest(from, count)) {
+            result.emplace_back(all_stops_[i].get(), distance);
+        }
+        return result;
+    }
+
+    std::vector<PrefixIndex::Entry> Catalogue::SuggestNames(std::string_view prefix, size_t count) const {
+        EnsureNamePrefixes();
+        return name_prefixes_.Suggest(prefix, count);
+    }
+
+    const std::vector<Bus*>& Catalogue::GetSortedAllBuses() const
     {
-        return buses_list_;
+        EnsureBusIndex();
+        return sorted_buses_;
     }
 
-    const std::map<std::string_view, Stop*>& Catalogue::GetSortedAllStops() const
+    const std::vector<Stop*>& Catalogue::GetSortedAllStops() const
     {
-        return stops_list_;
+        EnsureStopIndex();
+        return sorted_stops_;
+    }
+
+    const std::vector<std::shared_ptr<Stop>>& Catalogue::GetAllStops() const {
+        return all_stops_;
+    }
+
+    const std::vector<std::shared_ptr<Bus>>& Catalogue::GetAllBuses() const {
+        return all_buses_;
+    }
+
+    uint32_t Catalogue::GetStopId(const Stop* stop) const {
+        EnsureStopIndex();
+        return GetItemId(all_stops_, stop_index_, stop);
+    }
+
+    uint32_t Catalogue::GetBusId(const Bus* bus) const {
+        EnsureBusIndex();
+        return GetItemId(all_buses_, bus_index_, bus);
+    }
+
+    const NameIndex& Catalogue::GetStopIndex() const {
+        EnsureStopIndex();
+        return stop_index_;
+    }
+
+    const NameIndex& Catalogue::GetBusIndex() const {
+        EnsureBusIndex();
+        return bus_index_;
+    }
+
+    void Catalogue::SetStopIndex(NameIndex index) {
+        if (index.Size() != all_stops_.size()) {
+            throw std::invalid_argument("Stop index does not match catalogue"s);
+        }
+        stop_index_ = std::move(index);
+        sorted_stops_ = GetSortedItems(all_stops_, stop_index_);
+        stop_index_ready_ = true;
+    }
+
+    void Catalogue::SetBusIndex(NameIndex index) {
+        if (index.Size() != all_buses_.size()) {
+            throw std::invalid_argument("Bus index does not match catalogue"s);
+        }
+        bus_index_ = std::move(index);
+        sorted_buses_ = GetSortedItems(all_buses_, bus_index_);
+        bus_index_ready_ = true;
+    }
+
+    const SpatialIndex& Catalogue::GetStopGrid() const {
+        EnsureStopGrid();
+        return stop_grid_;
+    }
+
+    void Catalogue::SetStopGrid(SpatialIndex grid) {
+        if (grid.Size() != all_stops_.size()) {
+            throw std::invalid_argument("Stop grid does not match catalogue"s);
+        }
+        stop_grid_ = std::move(grid);
+        stop_grid_ready_ = true;
+    }
+
+    const PrefixIndex& Catalogue::GetNamePrefixes() const {
+        EnsureNamePrefixes();
+        return name_prefixes_;
+    }
+
+    void Catalogue::SetNamePrefixes(PrefixIndex prefixes) {
+        if (prefixes.Size() != all_stops_.size() + all_buses_.size()) {
+            throw std::invalid_argument("Prefix index does not match catalogue"s);
+        }
+        name_prefixes_ = std::move(prefixes);
+        name_prefixes_ready_ = true;
+    }
+
+    void Catalogue::AdoptNames(std::shared_ptr<const void> owner, std::string_view region) {
+        names_->Adopt(std::move(owner), region);
+    }
+
+    void Catalogue::BuildIndexes() {
+        EnsureStopIndex();
+        EnsureBusIndex();
+        EnsureStopGrid();
+        EnsureNamePrefixes();
+    }
+
+    void Catalogue::EnsureStopIndex() const {
+        if (stop_index_ready_) return;
+        stop_index_ = NameIndex(CollectNames(all_stops_));
+        sorted_stops_ = GetSortedItems(all_stops_, stop_index_);
+        stop_index_ready_ = true;
+    }
+
+    void Catalogue::EnsureBusIndex() const {
+        if (bus_index_ready_) return;
+        bus_index_ = NameIndex(CollectNames(all_buses_));
+        sorted_buses_ = GetSortedItems(all_buses_, bus_index_);
+        bus_index_ready_ = true;
+    }
+
+    void Catalogue::EnsureStopGrid() const {
+        if (stop_grid_ready_) return;
+        std::vector<geo::Coordinates> points;
+        points.reserve(all_stops_.size());
+        for (const auto& stop : all_stops_) {
+            points.push_back(stop->coordinates);
+        }
+        stop_grid_ = SpatialIndex(points);
+        stop_grid_ready_ = true;
+    }
+
+    void Catalogue::EnsureNamePrefixes() const {
+        if (name_prefixes_ready_) return;
+        std::vector<std::pair<std::string_view, PrefixIndex::Kind>> names;
+        names.reserve(all_stops_.size() + all_buses_.size());
+        for (const auto& stop : all_stops_) {
+            names.emplace_back(stop->name, PrefixIndex::Kind::STOP);
+        }
+        for (const auto& bus : all_buses_) {
+            names.emplace_back(bus->name, PrefixIndex::Kind::BUS);
+        }
+        name_prefixes_ = PrefixIndex(std::move(names));
+        name_prefixes_ready_ = true;
+    }
+
+    Stop* Catalogue::DetachStop(const Stop* stop) {
+        EnsureStopIndex();
+        auto slot = FindSlot(all_stops_, stop_index_, stop->name);
+        if (!slot) {
+            throw std::invalid_argument("Unknown stop "s + std::string(stop->name));
+        }
+        if (slot->use_count() == 1) return slot->get();
+        Stop* old_stop = slot->get();
+        *slot = std::make_shared<Stop>(*old_stop);
+        Stop* fresh_stop = slot->get();
+        // Маршруты через эту остановку должны ссылаться на новую копию
+        for (const auto& [bus_name, bus] : stop_to_buses_.at(fresh_stop->name)) {
+            Bus* own_bus = DetachBus(bus);
+            std::replace(own_bus->stops.begin(), own_bus->stops.end(), old_stop, fresh_stop);
+            if (own_bus->final_stop == old_stop) {
+                own_bus->final_stop = fresh_stop;
+            }
+        }
+        ReplaceSorted(sorted_stops_, old_stop, fresh_stop);
+        return fresh_stop;
+    }
+
+    Bus* Catalogue::DetachBus(const Bus* bus) {
+        EnsureBusIndex();
+        auto slot = FindSlot(all_buses_, bus_index_, bus->name);
+        if (!slot) {
+            throw std::invalid_argument("Unknown bus "s + std::string(bus->name));
+        }
+        if (slot->use_count() == 1) return slot->get();
+        Bus* old_bus = slot->get();
+        *slot = std::make_shared<Bus>(*old_bus);
+        Bus* fresh_bus = slot->get();
+        for (const Stop* s : fresh_bus->stops) {
+            stop_to_buses_[s->name][fresh_bus->name] = fresh_bus;
+        }
+        ReplaceSorted(sorted_buses_, old_bus, fresh_bus);
+        return fresh_bus;
+    }
+
+    CatalogueHolder::CatalogueHolder(Catalogue catalogue) {
+        auto initial = std::make_shared<Catalogue>(std::move(catalogue));
+        initial->BuildIndexes();
+        current_ = std::move(initial);
+    }
+
+    CatalogueHolder::Snapshot CatalogueHolder::Acquire() const {
+        return std::atomic_load(&current_);
     }
 
 }
\ No newline at end of file
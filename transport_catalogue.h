@@ -2,23 +2,42 @@
 
 #include "geo.h"
 #include "domain.h"
-
-#include <deque>
+#include "name_index.h"
+#include "prefix_index.h"
+#include "spatial_index.h"
+#include "string_arena.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <string_view>
 #include <map>
+#include <set>
 
 namespace tc {
 
     using namespace domain;
 
+    // Что изменилось в каталоге с точки зрения графа маршрутов
+    struct CatalogueChanges {
+        std::set<std::string> added_stops;
+        std::set<std::string> removed_stops;
+        // Добавленные, изменённые, удалённые маршруты и маршруты через остановки с новыми расстояниями
+        std::set<std::string> changed_buses;
+    };
+
+    // Копия каталога разделяет с оригиналом хранилище имён и все остановки и маршруты.
+    // Изменения через методы каталога копируют только затронутые объекты (copy-on-write),
+    // поэтому объекты, полученные через FindStop/FindBus, напрямую менять нельзя.
     class Catalogue {
     public:
-        void AddStop(const std::string& name, const geo::Coordinates& coordinates);
+        void AddStop(std::string_view name, const geo::Coordinates& coordinates);
 
-        void AddBus(const std::string& num, const std::vector<Stop*>& stops, bool is_circle);
+        void AddBus(std::string_view num, const std::vector<Stop*>& stops, bool is_circle);
 
         Stop* FindStop(const std::string_view stop);
 
@@ -36,15 +55,113 @@ namespace tc {
 
         int GetDistance(const Stop* from, const Stop* to) const;
 
-        const std::map <std::string_view, Bus*>& GetSortedAllBuses() const;
+        void SetFinalStop(const Bus* bus, const Stop* stop);
+
+        void SetStopCoordinates(const Stop* stop, const geo::Coordinates& coordinates);
+
+        // Заменяет остановки маршрута; конечную остановку нужно задать заново
+        void SetBusStops(const Bus* bus, const std::vector<Stop*>& stops, bool is_circle);
+
+        void RemoveBus(const Bus* bus);
+
+        // Удалять можно только остановку, через которую не проходит ни один маршрут
+        void RemoveStop(const Stop* stop);
+
+        // До count ближайших к точке остановок с расстояниями в метрах, по возрастанию расстояния
+        std::vector<std::pair<const Stop*, double>> FindNearestStops(const geo::Coordinates& from, size_t count) const;
+
+        // Не более count имён остановок и маршрутов, начинающихся с prefix
+        std::vector<PrefixIndex::Entry> SuggestNames(std::string_view prefix, size_t count) const;
+
+        const std::vector<Bus*>& GetSortedAllBuses() const;
+
+        const std::vector<Stop*>& GetSortedAllStops() const;
+
+        // Остановки и маршруты в порядке добавления; позиция совпадает с номером в индексе
+        const std::vector<std::shared_ptr<Stop>>& GetAllStops() const;
+
+        const std::vector<std::shared_ptr<Bus>>& GetAllBuses() const;
+
+        // Номер остановки или маршрута этой версии каталога, то есть позиция в GetAllStops
+        // и GetAllBuses. Бросает std::invalid_argument, если объект не из этой версии
+        uint32_t GetStopId(const Stop* stop) const;
+
+        uint32_t GetBusId(const Bus* bus) const;
+
+        const NameIndex& GetStopIndex() const;
+
+        const NameIndex& GetBusIndex() const;
 
-        const std::map <std::string_view, Stop*>& GetSortedAllStops() const;
+        // Подставляют готовый индекс (например, из базы) вместо перестроения
+        void SetStopIndex(NameIndex index);
+
+        void SetBusIndex(NameIndex index);
+
+        const SpatialIndex& GetStopGrid() const;
+
+        void SetStopGrid(SpatialIndex grid);
+
+        const PrefixIndex& GetNamePrefixes() const;
+
+        void SetNamePrefixes(PrefixIndex prefixes);
+
+        // Имена из region будут использоваться на месте, без копирования в хранилище каталога
+        void AdoptNames(std::shared_ptr<const void> owner, std::string_view region);
+
+        // Достраивает индексы заранее, после чего константные методы ничего не меняют
+        void BuildIndexes();
 
     private:
-        std::deque<Stop> all_stops_;
-        std::deque<Bus> all_buses_;
+        std::shared_ptr<StringArena> names_ = std::make_shared<StringArena>();
+        std::vector<std::shared_ptr<Stop>> all_stops_;
+        std::vector<std::shared_ptr<Bus>> all_buses_;
         std::unordered_map < std::string_view, std::map<std::string_view, Bus*>> stop_to_buses_;
-        std::map < std::string_view, Stop* > stops_list_;
-        std::map < std::string_view, Bus* > buses_list_;
+
+        // Индексы перестраиваются лениво при первом поиске после добавления
+        mutable NameIndex stop_index_;
+        mutable NameIndex bus_index_;
+        mutable std::vector<Stop*> sorted_stops_;
+        mutable std::vector<Bus*> sorted_buses_;
+        mutable bool stop_index_ready_ = true;
+        mutable bool bus_index_ready_ = true;
+        mutable SpatialIndex stop_grid_;
+        mutable bool stop_grid_ready_ = true;
+        mutable PrefixIndex name_prefixes_;
+        mutable bool name_prefixes_ready_ = true;
+
+        void EnsureStopIndex() const;
+        void EnsureBusIndex() const;
+        void EnsureStopGrid() const;
+        void EnsureNamePrefixes() const;
+
+        // Возвращают собственную копию объекта, если он разделяется с другой версией каталога
+        Stop* DetachStop(const Stop* stop);
+        Bus* DetachBus(const Bus* bus);
+    };
+
+    // Публикует неизменяемые версии каталога (в духе RCU): читатели закрепляют
+    // текущую версию на время запроса, писатель собирает следующую версию из
+    // предыдущей и атомарно подменяет указатель.
+    class CatalogueHolder {
+    public:
+        using Snapshot = std::shared_ptr<const Catalogue>;
+
+        explicit CatalogueHolder(Catalogue catalogue);
+
+        Snapshot Acquire() const;
+
+        // update получает изменяемую копию текущей версии; писатели выполняются по очереди
+        template <typename Updater>
+        void Update(Updater update) {
+            std::lock_guard<std::mutex> guard(writer_mutex_);
+            auto next = std::make_shared<Catalogue>(*Acquire());
+            update(*next);
+            next->BuildIndexes();
+            std::atomic_store(&current_, Snapshot(std::move(next)));
+        }
+
+    private:
+        Snapshot current_;
+        std::mutex writer_mutex_;
     };
 }
\ No newline at end of file
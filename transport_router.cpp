@@ -6,6 +6,7 @@
 #include <utility>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 using namespace std;
 
@@ -25,32 +26,33 @@ namespace tc {
 
     Router::Router(const json::Node& settings_node,
         graph::DirectedWeightedGraph<double> graph,
-        std::map<std::string, graph::VertexId> stop_ids)
+        StopIds stop_ids)
         : graph_(graph)
         , stop_ids_(stop_ids)
     {
         if (settings_node.IsNull()) return;
         SetSettings(settings_node);
-        router_ptr_ = new graph::Router<double>(graph_);
+        router_ptr_ = new graph::Router<double>(graph_, &ThreadPool::GetShared());
     }
 
     void Router::SetGraph(graph::DirectedWeightedGraph<double>&& graph,
-        std::map<std::string, graph::VertexId>&& stop_ids) {
+        StopIds&& stop_ids) {
         graph_ = move(graph);
         stop_ids_ = move(stop_ids);
-        router_ptr_ = new graph::Router<double>(graph_);
+        delete router_ptr_;
+        router_ptr_ = new graph::Router<double>(graph_, &ThreadPool::GetShared());
     }
 
     const graph::DirectedWeightedGraph<double>& Router::BuildGraph(const Catalogue& tcat)
     {
-        const map<string_view, Stop*>& all_stops = tcat.GetSortedAllStops();
-        const map<string_view, Bus*>& all_buses = tcat.GetSortedAllBuses();
+        const vector<Stop*>& all_stops = tcat.GetSortedAllStops();
+        const vector<Bus*>& all_buses = tcat.GetSortedAllBuses();
         graph::DirectedWeightedGraph<double> stops_graph(all_stops.size() * 2);
-        map<std::string, graph::VertexId> stop_ids;
+        StopIds stop_ids;
         graph::VertexId vertex_id = 0;
-        for (const auto& [stop_name, stop_ptr] : all_stops) {
-            stop_ids[stop_ptr->name] = vertex_id;
-            stops_graph.AddEdge({ stop_ptr->name,
+        for (const Stop* stop_ptr : all_stops) {
+            stop_ids.emplace(stop_ptr->name, vertex_id);
+            stops_graph.AddEdge({ static_cast<string>(stop_ptr->name),
                                   0,
                                   vertex_id,
                                   ++vertex_id,
@@ -59,37 +61,87 @@ namespace tc {
         }
         stop_ids_ = move(stop_ids);
 
-        for_each(
-            all_buses.begin(),
-            all_buses.end(),
-            [&stops_graph, this](const auto& item)
-            {
-                const auto& bus_ptr = item.second;
-                const std::vector<Stop*>& stops = bus_ptr->stops;
-                size_t stops_count = stops.size();
-                for (size_t i = 0; i < stops_count; ++i) {
-                    for (size_t j = i + 1; j < stops_count; ++j) {
-                        const Stop* stop_from = stops[i];
-                        const Stop* stop_to = stops[j];
-                        int dist_sum = 0;
-                        for (size_t k = i + 1; k <= j; ++k) {
-                            dist_sum += stops[k - 1]->GetDistance(stops[k]);
-                        }
-                        stops_graph.AddEdge({ bus_ptr->name,
-                                              j - i,
-                                              stop_ids_.at(stop_from->name) + 1,
-                                              stop_ids_.at(stop_to->name),
-                                              static_cast<double>(dist_sum) / (bus_velocity_ * (100.0 / 6.0)) });
-                        if (!bus_ptr->is_circle && stop_to == bus_ptr->final_stop && j == stops_count / 2) break;
-                    }
-                }
-            });
+        for (const Bus* bus_ptr : all_buses) {
+            for (auto& edge : GetBusEdges(bus_ptr)) {
+                stops_graph.AddEdge(move(edge));
+            }
+        }
 
         graph_ = move(stops_graph);
-        router_ptr_ = new graph::Router<double>(graph_);
         return graph_;
     }
 
+    void Router::UpdateGraph(const Catalogue& tcat, graph::DirectedWeightedGraph<double>&& graph,
+        StopIds&& stop_ids, const CatalogueChanges& changes)
+    {
+        stop_ids_ = move(stop_ids);
+        // Вершины удалённых остановок остаются изолированными, новые остановки получают вершины в конце
+        for (const string& name : changes.removed_stops) {
+            stop_ids_.erase(name);
+        }
+        graph::VertexId vertex_count = graph.GetVertexCount();
+        vector<graph::Edge<double>> added_wait_edges;
+        for (const string& name : changes.added_stops) {
+            if (stop_ids_.emplace(name, vertex_count).second) {
+                added_wait_edges.push_back({ name, 0, vertex_count, vertex_count + 1,
+                                             static_cast<double>(bus_wait_time_) });
+                vertex_count += 2;
+            }
+        }
+
+        vector<graph::Edge<double>> edges;
+        edges.reserve(graph.GetEdgeCount());
+        for (graph::EdgeId id = 0; id < graph.GetEdgeCount(); ++id) {
+            const graph::Edge<double>& edge = graph.GetEdge(id);
+            const bool keep = edge.quality == 0
+                ? stop_ids_.count(edge.name) > 0
+                : changes.changed_buses.count(edge.name) == 0;
+            if (keep) {
+                edges.push_back(edge);
+            }
+        }
+        for (auto& edge : added_wait_edges) {
+            edges.push_back(move(edge));
+        }
+        for (const string& name : changes.changed_buses) {
+            if (const Bus* bus = tcat.FindBus(name)) {
+                for (auto& edge : GetBusEdges(bus)) {
+                    edges.push_back(move(edge));
+                }
+            }
+        }
+
+        vector<vector<graph::EdgeId>> incidence_lists(vertex_count);
+        for (graph::EdgeId id = 0; id < edges.size(); ++id) {
+            incidence_lists[edges[id].from].push_back(id);
+        }
+        graph_ = graph::DirectedWeightedGraph<double>(move(edges), move(incidence_lists));
+    }
+
+    vector<graph::Edge<double>> Router::GetBusEdges(const Bus* bus_ptr) const
+    {
+        vector<graph::Edge<double>> result;
+        const std::vector<Stop*>& stops = bus_ptr->stops;
+        size_t stops_count = stops.size();
+        for (size_t i = 0; i < stops_count; ++i) {
+            for (size_t j = i + 1; j < stops_count; ++j) {
+                const Stop* stop_from = stops[i];
+                const Stop* stop_to = stops[j];
+                int dist_sum = 0;
+                for (size_t k = i + 1; k <= j; ++k) {
+                    dist_sum += stops[k - 1]->GetDistance(stops[k]);
+                }
+                result.push_back({ static_cast<string>(bus_ptr->name),
+                                   j - i,
+                                   GetStopVertex(stop_from->name) + 1,
+                                   GetStopVertex(stop_to->name),
+                                   static_cast<double>(dist_sum) / (bus_velocity_ * (100.0 / 6.0)) });
+                if (!bus_ptr->is_circle && stop_to == bus_ptr->final_stop && j == stops_count / 2) break;
+            }
+        }
+        return result;
+    }
+
     json::Array Router::GetEdgesItems(const std::vector<graph::EdgeId>& edges) const
     {
         json::Array items_array;
@@ -117,7 +169,14 @@ namespace tc {
 
     std::optional<graph::Router<double>::RouteInfo> Router::GetRouteInfo(const Stop* from, const Stop* to) const
     {
-        return router_ptr_->BuildRoute(stop_ids_.at(from->name), stop_ids_.at(to->name));
+        // Остановки, добавленные в каталог после построения графа, маршрутов не имеют
+        if (!stop_ids_.count(from->name) || !stop_ids_.count(to->name)) {
+            return std::nullopt;
+        }
+        if (!router_ptr_) {
+            throw logic_error("Routes are not built"s);
+        }
+        return router_ptr_->BuildRoute(GetStopVertex(from->name), GetStopVertex(to->name));
     }
 
     size_t Router::GetGraphVertexCount()
@@ -125,7 +184,7 @@ namespace tc {
         return graph_.GetVertexCount();
     }
 
-    const std::map<std::string, graph::VertexId>& Router::GetStopIds() const {
+    const StopIds& Router::GetStopIds() const {
         return stop_ids_;
     }
 
@@ -145,4 +204,11 @@ namespace tc {
         bus_velocity_ = settings_node.AsDict().at("bus_velocity"s).AsDouble();
     }
 
+    graph::VertexId Router::GetStopVertex(std::string_view stop_name) const {
+        if (auto it = stop_ids_.find(stop_name); it != stop_ids_.end()) {
+            return it->second;
+        }
+        throw std::out_of_range("Unknown stop "s + static_cast<string>(stop_name));
+    }
+
 } // transport
@@ -12,6 +12,9 @@
 
 namespace tc {
 
+    // Прозрачный компаратор позволяет искать вершину по string_view без копирования имени
+    using StopIds = std::map<std::string, graph::VertexId, std::less<>>;
+
     class Router {
     public:
         Router() = default;
@@ -20,20 +23,27 @@ namespace tc {
         Router(const json::Node& settings_node, const Catalogue& tcat);
         Router(const json::Node& settings_node,
             graph::DirectedWeightedGraph<double> graph,
-            std::map<std::string, graph::VertexId> stop_ids);
+            StopIds stop_ids);
 
         void SetGraph(graph::DirectedWeightedGraph<double>&& graph,
-            std::map<std::string, graph::VertexId>&& stop_ids);
+            StopIds&& stop_ids);
 
+        // Только строит граф: таблица всех маршрутов занимает квадрат от числа вершин и для
+        // записи базы не нужна. Её строят SetGraph и конструктор с готовым графом.
         const graph::DirectedWeightedGraph<double>& BuildGraph(const Catalogue& tcat);
 
+        // Переносит в граф изменения каталога: пересчитываются рёбра только затронутых
+        // маршрутов и остановок. Маршрутизатор при этом не строится.
+        void UpdateGraph(const Catalogue& tcat, graph::DirectedWeightedGraph<double>&& graph,
+            StopIds&& stop_ids, const CatalogueChanges& changes);
+
         json::Array GetEdgesItems(const std::vector<graph::EdgeId>& edges) const;
 
         std::optional<graph::Router<double>::RouteInfo> GetRouteInfo(const Stop* from, const Stop* to) const;
 
         size_t GetGraphVertexCount();
 
-        const std::map<std::string, graph::VertexId>& GetStopIds() const;
+        const StopIds& GetStopIds() const;
 
         const graph::DirectedWeightedGraph<double>& GetGraph() const;
 
@@ -48,11 +58,15 @@ namespace tc {
         double bus_velocity_ = 0;
 
         graph::DirectedWeightedGraph<double> graph_;
-        std::map<std::string, graph::VertexId> stop_ids_;
+        StopIds stop_ids_;
 
         graph::Router<double>* router_ptr_ = nullptr;
 
         void SetSettings(const json::Node& settings_node);
+
+        graph::VertexId GetStopVertex(std::string_view stop_name) const;
+
+        std::vector<graph::Edge<double>> GetBusEdges(const Bus* bus_ptr) const;
     };
 
 } // namespace tc
\ No newline at end of file